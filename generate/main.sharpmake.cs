@@ -34,6 +34,31 @@ class Game : RynxProject
     }
 }
 
+[Generate]
+class GameTests : RynxProject
+{
+    public GameTests()
+    {
+        SourceRootPath = @"[project.SharpmakeCsPath]\..\tests\";
+    }
+	
+	[Configure]
+    public void ConfigureAll(Project.Configuration conf, Target target)
+    {
+		conf.AddPublicDependency<RuleSets>(target);
+		conf.AddPublicDependency<Tech>(target);
+		conf.AddPublicDependency<Scheduler>(target);
+		
+		conf.IncludePaths.Add(@"[project.SharpmakeCsPath]\..\src\game\");
+		conf.IncludePaths.Add(@"[project.SharpmakeCsPath]\..\rynx\external\catch2\");
+		
+		conf.TargetFileName = Name;
+		conf.SolutionFolder = "";
+		conf.TargetPath = @"[project.SharpmakeCsPath]\..\build\bin\";
+		conf.Output = Project.Configuration.OutputType.Exe;
+    }
+}
+
 [Generate]
 class PutkaGame : Solution
 {
@@ -50,6 +75,7 @@ class PutkaGame : Solution
     {
         conf.SolutionPath = @"[solution.SharpmakeCsPath]\..";
         conf.AddProject<Game>(target);
+		conf.AddProject<GameTests>(target);
 		conf.AddProject<TestTech>(target);
 		conf.AddProject<TestScheduler>(target);
 	}
@@ -0,0 +1,151 @@
+
+#pragma once
+
+#include <rynx/application/logic.hpp>
+#include <rynx/tech/components.hpp>
+#include <rynx/tech/ecs.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "cached_query.hpp"
+#include "ecs_commands.hpp"
+#include "frame_clock.hpp"
+#include "parallel.hpp"
+#include "task_timeline.hpp"
+#include "update_lod.hpp"
+
+namespace game {
+
+	// particle that only stores how it was launched. its path under constant acceleration and exponential
+	// velocity damping has a closed form, so position, radius and color are evaluated for the render time
+	// instead of being integrated every logic tick. these entities have no motion, lifetime or particle_info,
+	// so no logic ruleset visits them.
+	struct ballistic_particle {
+		rynx::vec3f origin;
+		rynx::vec3f velocity;
+		rynx::vec3f acceleration; // gravity and lift
+		float damping = 0; // velocity decays as exp(-damping * t)
+		double spawn_time = 0;
+		float lifetime = 1;
+		rynx::floats4 color_begin;
+		rynx::floats4 color_end;
+		float radius_begin = 1;
+		float radius_end = 1;
+		uint64_t next_update = 0; // logic frame the particle is evaluated next, kept by ballistic_particles
+
+		// rate for a dampening component value, which keeps (1 - dampening) of the velocity per second.
+		static float damping_from(float dampening) {
+			return -std::log(std::max(1.0f - dampening, 1e-3f));
+		}
+
+		// displacement from origin at age t.
+		rynx::vec3f offset(float t) const {
+			if (damping < 1e-4f)
+				return velocity * t + acceleration * (0.5f * t * t);
+
+			float decayed = (1.0f - std::exp(-damping * t)) / damping;
+			rynx::vec3f drift = acceleration * (1.0f / damping);
+			return (velocity - drift) * decayed + drift * t;
+		}
+	};
+
+	// evaluates ballistic particles for the end of the logic frame, which is what gets rendered, and retires
+	// the ones that burned out. runs as a frame task next to the other rulesets, spread over the job pool.
+	// with an lod policy, particles away from the view are evaluated only every few frames, each particle
+	// keeps the frame of its next evaluation and is not looked at in between beyond its age. the path is a
+	// closed form of time, so skipped frames need no catching up. off screen particles that will also be
+	// off screen when they burn out are retired right away.
+	class ballistic_particles : public rynx::application::logic::iruleset {
+	public:
+		ballistic_particles(job_pool& pool, ecs_commands& commands, uint32_t command_channel, component_versions& versions, task_timeline& timeline, lod_policy lod = {})
+			: m_pool(pool), m_commands(commands), m_channel(command_channel), m_particles(versions), m_lod(lod), m_timeline(timeline)
+		{
+			m_place_node = timeline.declare("place particles", this);
+		}
+
+		virtual void onFrameProcess(rynx::scheduler::context& context, float) override {
+			context.add_task("place particles", [this](
+				rynx::ecs::view<
+					ballistic_particle,
+					const rynx::components::dead,
+					rynx::components::position,
+					rynx::components::radius,
+					rynx::components::color> ecs,
+				const frame_clock& clock,
+				const lod_view& view)
+			{
+				auto timing = m_timeline.record(m_place_node);
+				update(ecs, clock.time + clock.dt, clock.dt, clock.frame, view);
+			});
+		}
+
+	private:
+		template<typename Ecs>
+		void update(Ecs& ecs, double time, float dt, uint64_t frame, const lod_view& view) {
+			const auto& ids = m_particles.ids(ecs);
+			m_expired.assign(ids.size(), 0);
+
+			m_pool.parallel_for(ids.size(), 1024, [&](size_t, size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i) {
+					auto entity = ecs[ids[i]];
+					auto& p = entity.template get<ballistic_particle>();
+					float age = float(time - p.spawn_time);
+					if (age >= p.lifetime) {
+						m_expired[i] = 1;
+						continue;
+					}
+
+					if (frame < p.next_update)
+						continue;
+
+					// classified by where the particle is now. a particle heading into view is classified by where
+					// it will be at its next update too, so it doesn't stay coarse for an interval after entering.
+					float t = std::max(age, 0.0f);
+					float f = t / p.lifetime;
+					rynx::vec3f now = p.origin + p.offset(t);
+					float r = p.radius_begin + (p.radius_end - p.radius_begin) * f;
+					auto level = m_lod.classify(view, now, r);
+					if (level != lod_policy::level::near) {
+						float t_next = std::min(t + dt * m_lod.interval(level), p.lifetime);
+						auto next_level = m_lod.classify(view, p.origin + p.offset(t_next), std::max(p.radius_begin, p.radius_end));
+						level = std::min(level, next_level);
+					}
+
+					if (level == lod_policy::level::offscreen && m_lod.expire_offscreen) {
+						float largest = std::max(p.radius_begin, p.radius_end);
+						if (!view.visible(p.origin + p.offset(p.lifetime), largest)) {
+							m_expired[i] = 1;
+							continue;
+						}
+					}
+
+					// the update after a particle's first one is spread over the interval by id, so particles spawned
+					// together don't all come due on the same tick. after that each keeps its own rhythm.
+					uint32_t interval = m_lod.interval(level);
+					p.next_update = frame + (p.next_update == 0 ? 1 + (ids[i].value + frame) % interval : interval);
+
+					entity.template get<rynx::components::position>().value = now;
+					entity.template get<rynx::components::radius>().r = r;
+					entity.template get<rynx::components::color>().value = p.color_begin * (1.0f - f) + p.color_end * f;
+				}
+			});
+
+			ecs_commands::recorder commands(m_commands, m_channel);
+			for (size_t i = 0; i < ids.size(); ++i)
+				if (m_expired[i])
+					commands.erase(ids[i]);
+		}
+
+		job_pool& m_pool;
+		ecs_commands& m_commands;
+		uint32_t m_channel;
+		cached_query<types<ballistic_particle>, types<rynx::components::dead>> m_particles;
+		lod_policy m_lod;
+		std::vector<uint8_t> m_expired;
+
+		task_timeline& m_timeline;
+		task_timeline::node m_place_node;
+	};
+}
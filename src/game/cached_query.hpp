@@ -0,0 +1,172 @@
+
+#pragma once
+
+#include <rynx/tech/ecs.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+namespace game {
+
+	template<typename... Ts> struct types {};
+
+	// structural change versions per component type, one set per ecs. a type's version is bumped whenever it
+	// is attached to or removed from an entity, or an entity carrying it is created or erased through the game's
+	// structural change points (ecs_commands playback, dead entity clean up, level construction).
+	// versions are only modified from the main thread while no frame tasks are running.
+	class component_versions {
+	public:
+		static constexpr size_t max_types = 128;
+
+		// type indices are process wide, versions are not.
+		template<typename T>
+		static size_t type_index() {
+			static const size_t index = next_type_index();
+			return index;
+		}
+
+		template<typename... Ts>
+		void touch() {
+			uint64_t version = ++m_counter;
+			((m_versions[type_index<std::decay_t<Ts>>()] = version), ...);
+		}
+
+		// for changes where the affected types are not known, for example ecs.clear().
+		void touch_all() {
+			m_global_version = ++m_counter;
+		}
+
+		template<typename T>
+		uint64_t get() const {
+			return std::max(m_versions[type_index<T>()], m_global_version);
+		}
+
+		// erasing entities changes the versions of all their components. only types that someone
+		// is caching queries for are checked.
+		template<typename T>
+		void track() {
+			size_t index = type_index<T>();
+			for (const auto& tracked : m_tracked)
+				if (tracked.index == index)
+					return;
+			m_tracked.push_back({ index, [](rynx::ecs& ecs, rynx::ecs::id id) { return ecs[id].has<T>(); } });
+		}
+
+		void entities_erased(rynx::ecs& ecs, const std::vector<rynx::ecs::id>& ids) {
+			if (ids.empty())
+				return;
+
+			uint64_t version = ++m_counter;
+			for (const auto& tracked : m_tracked) {
+				for (auto id : ids) {
+					if (tracked.has(ecs, id)) {
+						m_versions[tracked.index] = version;
+						break;
+					}
+				}
+			}
+		}
+
+	private:
+		struct tracked_type {
+			size_t index;
+			bool (*has)(rynx::ecs&, rynx::ecs::id);
+		};
+
+		static size_t next_type_index() {
+			static std::atomic<size_t> type_count = 0;
+			size_t index = type_count.fetch_add(1);
+			rynx_assert(index < max_types, "too many component types with change versions");
+			return index;
+		}
+
+		uint64_t m_counter = 1;
+		uint64_t m_global_version = 1;
+		std::array<uint64_t, max_types> m_versions{};
+		std::vector<tracked_type> m_tracked;
+	};
+
+	template<typename In, typename NotIn = types<>>
+	class cached_query;
+
+	// entity ids matching a query that are kept across frames. the id list is only rebuilt when one
+	// of the queried component types has had structural changes since the previous rebuild.
+	template<typename... In, typename... NotIn>
+	class cached_query<types<In...>, types<NotIn...>> {
+	public:
+		cached_query(component_versions& versions) : m_versions(versions) {
+			(versions.track<In>(), ...);
+			(versions.track<NotIn>(), ...);
+		}
+
+		// works with the full ecs as well as with ecs views that can see the queried types.
+		template<typename Ecs>
+		const std::vector<rynx::ecs::id>& ids(Ecs& ecs) {
+			uint64_t version = std::max({ m_versions.get<In>()..., m_versions.get<NotIn>()... });
+			if (version != m_version) {
+				if constexpr (sizeof...(NotIn) > 0)
+					m_ids = ecs.query().template in<In...>().template notIn<NotIn...>().ids();
+				else
+					m_ids = ecs.query().template in<In...>().ids();
+				m_version = version;
+			}
+			return m_ids;
+		}
+
+		// changes whenever the id list was rebuilt. users can key their own derived data on this.
+		uint64_t version() const {
+			return m_version;
+		}
+
+	private:
+		const component_versions& m_versions;
+		std::vector<rynx::ecs::id> m_ids;
+		uint64_t m_version = 0;
+	};
+
+	// per entity change detection for systems that only want to visit entities whose component value
+	// changed since their previous run. component writes are not tracked by the ecs, so values are
+	// compared against a snapshot taken on the previous run. the snapshot is kept parallel to an id list,
+	// call reset() whenever that list changes.
+	template<typename T>
+	class change_filter {
+		static_assert(std::is_trivially_copyable_v<T>, "change_filter compares raw component bytes");
+
+	public:
+		void reset() {
+			m_snapshot.clear();
+			m_seen.clear();
+		}
+
+		// calls op(index, value) for each ids[index] whose T differs from the previous run.
+		template<typename Ecs, typename F>
+		void for_each_changed(Ecs& ecs, const std::vector<rynx::ecs::id>& ids, F&& op) {
+			if (m_snapshot.size() != ids.size()) {
+				m_snapshot.resize(ids.size());
+				m_seen.assign(ids.size(), 0);
+			}
+
+			for (size_t i = 0; i < ids.size(); ++i) {
+				if (!ecs.exists(ids[i]))
+					continue;
+
+				const T& value = ecs[ids[i]].template get<const T>();
+				if (m_seen[i] && std::memcmp(&m_snapshot[i], &value, sizeof(T)) == 0)
+					continue;
+
+				m_snapshot[i] = value;
+				m_seen[i] = 1;
+				op(i, value);
+			}
+		}
+
+	private:
+		std::vector<T> m_snapshot;
+		std::vector<uint8_t> m_seen;
+	};
+}
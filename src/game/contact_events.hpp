@@ -0,0 +1,275 @@
+
+#pragma once
+
+#include <rynx/application/logic.hpp>
+#include <rynx/tech/components.hpp>
+#include <rynx/tech/ecs.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "parallel.hpp"
+#include "static_outline.hpp"
+#include "task_timeline.hpp"
+
+namespace game {
+
+	// one touching pair of bodies, or a body touching the terrain outline.
+	struct contact_event {
+		rynx::ecs::id a;
+		rynx::ecs::id b; // the terrain entity for contacts with the static outline
+		uint64_t category_a = 0;
+		uint64_t category_b = 0;
+		rynx::vec3f normal; // unit, from a towards b
+		rynx::vec3f relative_velocity; // velocity of a minus velocity of b
+		float impulse = 0; // approach speed times the reduced mass of the pair
+
+		// positive while the bodies move towards each other.
+		float approach_speed() const { return relative_velocity.dot(normal); }
+
+		bool involves(rynx::ecs::id id) const { return a.value == id.value || b.value == id.value; }
+		rynx::ecs::id other(rynx::ecs::id id) const { return a.value == id.value ? b : a; }
+	};
+
+	// contacts of one frame. the detecting task writes into one buffer per chunk of its parallel loop,
+	// buffers grow as needed and keep their capacity across frames, so no contact is ever lost.
+	// written by one task per frame, read by later tasks and the main thread until the next frame's write.
+	class contact_events {
+	public:
+		contact_events() = default;
+		contact_events(const contact_events&) = delete;
+		contact_events& operator = (const contact_events&) = delete;
+
+		// by the writing task, before its parallel loop. drops the previous frame's contacts.
+		void begin_write(size_t chunks) {
+			if (m_chunks.size() < chunks)
+				m_chunks.resize(chunks);
+			for (auto& chunk : m_chunks)
+				chunk.clear();
+		}
+
+		// only ever written by the thread running that chunk.
+		std::vector<contact_event>& chunk(size_t index) { return m_chunks[index]; }
+
+		class query_t {
+		public:
+			query_t(const contact_events& events) : m_events(events) {}
+
+			// contacts where either side is of the category.
+			query_t& category(uint64_t c) { m_category = c; m_filter_category = true; return *this; }
+
+			// contacts where either side is the entity.
+			query_t& entity(rynx::ecs::id id) { m_entity = id; m_filter_entity = true; return *this; }
+
+			template<typename F>
+			void for_each(F&& op) const {
+				for (const auto& chunk : m_events.m_chunks) {
+					for (const auto& event : chunk) {
+						if (m_filter_category && event.category_a != m_category && event.category_b != m_category)
+							continue;
+						if (m_filter_entity && !event.involves(m_entity))
+							continue;
+						op(event);
+					}
+				}
+			}
+
+		private:
+			const contact_events& m_events;
+			uint64_t m_category = 0;
+			rynx::ecs::id m_entity;
+			bool m_filter_category = false;
+			bool m_filter_entity = false;
+		};
+
+		query_t query() const { return query_t(*this); }
+
+		size_t size() const {
+			size_t total = 0;
+			for (const auto& chunk : m_chunks)
+				total += chunk.size();
+			return total;
+		}
+
+	private:
+		std::vector<std::vector<contact_event>> m_chunks;
+	};
+
+	struct contact_detection_config {
+		float margin = 0.05f; // bodies this close count as touching, so resting contacts are not missed
+	};
+
+	// finds touching body pairs and bodies touching the terrain outline, and records them as contact_events.
+	// runs on the frame's final positions right before the physics resolves them, so relative velocities
+	// are the ones the bodies hit each other with. pairs are only tested between enabled category pairs.
+	class contact_detection : public rynx::application::logic::iruleset {
+	public:
+		contact_detection(job_pool& pool, task_timeline& timeline, const static_outline& terrain, contact_detection_config config = {})
+			: m_pool(pool), m_timeline(timeline), m_terrain(terrain), m_config(config)
+		{
+			m_detect_node = timeline.declare("detect contacts", this);
+		}
+
+		void enable_contacts_between(uint64_t category_a, uint64_t category_b) {
+			size_t a = slot(category_a);
+			size_t b = slot(category_b);
+			m_pairs[a * max_categories + b] = 1;
+			m_pairs[b * max_categories + a] = 1;
+		}
+
+		void enable_terrain_contacts(uint64_t category) {
+			m_with_terrain[slot(category)] = 1;
+		}
+
+		virtual void onFrameProcess(rynx::scheduler::context& context, float) override {
+			context.add_task("detect contacts", [this](
+				rynx::ecs::view<
+					const rynx::components::position,
+					const rynx::components::motion,
+					const rynx::components::radius,
+					const rynx::components::collisions,
+					const rynx::components::physical_body> ecs,
+				contact_events& contacts)
+			{
+				auto timing = m_timeline.record(m_detect_node);
+
+				m_bodies.clear();
+				auto add_body = [this](rynx::ecs::id id, const rynx::components::position& pos, const rynx::components::radius& r, const rynx::components::collisions& c, const rynx::components::physical_body& body, rynx::vec3f velocity) {
+					int32_t s = find_slot(c.category);
+					if (s >= 0)
+						m_bodies.push_back({ id, pos.value.x, pos.value.y, r.r, velocity.x, velocity.y, body.inv_mass, c.category, uint32_t(s) });
+				};
+				ecs.query().for_each([&add_body](rynx::ecs::id id, const rynx::components::position& pos, const rynx::components::radius& r, const rynx::components::collisions& c, const rynx::components::physical_body& body, const rynx::components::motion& m) {
+					add_body(id, pos, r, c, body, m.velocity);
+				});
+				ecs.query().notIn<rynx::components::motion>().for_each([&add_body](rynx::ecs::id id, const rynx::components::position& pos, const rynx::components::radius& r, const rynx::components::collisions& c, const rynx::components::physical_body& body) {
+					add_body(id, pos, r, c, body, {});
+				});
+
+				// sort and sweep on x, every body tests the ones starting after it within its reach.
+				std::sort(m_bodies.begin(), m_bodies.end(), [](const body& a, const body& b) { return a.x - a.r < b.x - b.r; });
+
+				contacts.begin_write(job_pool::chunk_count(m_bodies.size(), grain_size));
+				m_pool.parallel_for(m_bodies.size(), grain_size, [this, &contacts](size_t chunk, size_t begin, size_t end) {
+					auto& out = contacts.chunk(chunk);
+					for (size_t i = begin; i < end; ++i) {
+						detect_bodies(i, out);
+						if (m_with_terrain[m_bodies[i].slot])
+							detect_terrain(m_bodies[i], out);
+					}
+				});
+			});
+		}
+
+	private:
+		static constexpr size_t max_categories = 16;
+		static constexpr size_t grain_size = 64;
+
+		struct body {
+			rynx::ecs::id id;
+			float x, y, r;
+			float vx, vy;
+			float inv_mass;
+			uint64_t category;
+			uint32_t slot;
+		};
+
+		size_t slot(uint64_t category) {
+			int32_t s = find_slot(category);
+			if (s >= 0)
+				return size_t(s);
+			rynx_assert(m_categories.size() < max_categories, "too many contact categories");
+			m_categories.emplace_back(category);
+			return m_categories.size() - 1;
+		}
+
+		int32_t find_slot(uint64_t category) const {
+			for (size_t i = 0; i < m_categories.size(); ++i)
+				if (m_categories[i] == category)
+					return int32_t(i);
+			return -1;
+		}
+
+		static float reduced_mass(float inv_mass_a, float inv_mass_b) {
+			float inv_sum = inv_mass_a + inv_mass_b;
+			return inv_sum > 0.0f ? 1.0f / inv_sum : 0.0f;
+		}
+
+		void detect_bodies(size_t i, std::vector<contact_event>& out) const {
+			const body& p = m_bodies[i];
+			float end_x = p.x + p.r + m_config.margin;
+			for (size_t j = i + 1; j < m_bodies.size() && m_bodies[j].x - m_bodies[j].r <= end_x; ++j) {
+				const body& q = m_bodies[j];
+				if (!m_pairs[p.slot * max_categories + q.slot])
+					continue;
+
+				float dx = q.x - p.x;
+				float dy = q.y - p.y;
+				float reach = p.r + q.r + m_config.margin;
+				float distance_sqr = dx * dx + dy * dy;
+				if (distance_sqr > reach * reach)
+					continue;
+
+				float distance = std::sqrt(distance_sqr);
+				contact_event event;
+				event.a = p.id;
+				event.b = q.id;
+				event.category_a = p.category;
+				event.category_b = q.category;
+				event.normal = distance > 0.0f ? rynx::vec3f(dx / distance, dy / distance, 0) : rynx::vec3f(1, 0, 0);
+				event.relative_velocity = rynx::vec3f(p.vx - q.vx, p.vy - q.vy, 0);
+				event.impulse = std::max(0.0f, event.approach_speed()) * reduced_mass(p.inv_mass, q.inv_mass);
+				out.emplace_back(event);
+			}
+		}
+
+		// one contact with the nearest segment, a body at a corner touches both segments at the same point.
+		void detect_terrain(const body& p, std::vector<contact_event>& out) const {
+			float reach = p.r + m_config.margin;
+			float best_sqr = reach * reach;
+			float best_dx = 0, best_dy = 0;
+			bool touching = false;
+			m_terrain.for_each_near(p.x - reach, p.y - reach, p.x + reach, p.y + reach, [&](const static_outline::segment& s) {
+				float qx, qy;
+				static_outline::closest_point(s, p.x, p.y, qx, qy);
+				float dx = qx - p.x;
+				float dy = qy - p.y;
+				float distance_sqr = dx * dx + dy * dy;
+				if (distance_sqr <= best_sqr) {
+					best_sqr = distance_sqr;
+					best_dx = dx;
+					best_dy = dy;
+					touching = true;
+				}
+			});
+
+			if (!touching)
+				return;
+
+			float distance = std::sqrt(best_sqr);
+			contact_event event;
+			event.a = p.id;
+			event.b = m_terrain.terrain();
+			event.category_a = p.category;
+			event.category_b = m_terrain.category();
+			event.normal = distance > 0.0f ? rynx::vec3f(best_dx / distance, best_dy / distance, 0) : rynx::vec3f(0, -1, 0);
+			event.relative_velocity = rynx::vec3f(p.vx, p.vy, 0);
+			event.impulse = p.inv_mass > 0.0f ? std::max(0.0f, event.approach_speed()) / p.inv_mass : 0.0f;
+			out.emplace_back(event);
+		}
+
+		job_pool& m_pool;
+		task_timeline& m_timeline;
+		task_timeline::node m_detect_node;
+		const static_outline& m_terrain;
+		contact_detection_config m_config;
+
+		std::vector<uint64_t> m_categories;
+		uint8_t m_pairs[max_categories * max_categories] = {};
+		uint8_t m_with_terrain[max_categories] = {};
+
+		std::vector<body> m_bodies;
+	};
+}
@@ -0,0 +1,269 @@
+
+#pragma once
+
+#include <rynx/application/logic.hpp>
+#include <rynx/tech/components.hpp>
+#include <rynx/tech/ecs.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "parallel.hpp"
+#include "static_outline.hpp"
+#include "task_timeline.hpp"
+
+namespace game {
+
+	struct continuous_collision_config {
+		bool enabled = true;
+
+		// bodies that move less than this fraction of their radius in a frame are left to regular collision detection.
+		float min_travel = 0.5f;
+
+		// how deep a swept body is left inside what it hit, so the regular narrowphase sees the contact
+		// and resolves it with the body's velocity, damage events included.
+		float penetration = 0.05f;
+	};
+
+	// swept sphere tests for fast bodies, so the logic can run with larger time steps without bodies
+	// tunneling through thin terrain or each other. bodies of the selected collision categories are
+	// snapshotted before motion updates. after integration their paths are tested against the static
+	// outline, against each other and against resting obstacles like sleeping bodies, and bodies that
+	// would have passed through something are moved back to where they first touched it. velocities
+	// are not changed, the collision itself is still handled by the physics ruleset.
+	class continuous_collisions : public rynx::application::logic::iruleset {
+	public:
+		continuous_collisions(job_pool& pool, task_timeline& timeline, const static_outline& terrain, continuous_collision_config config = {})
+			: m_pool(pool), m_timeline(timeline), m_terrain(terrain), m_config(config)
+		{
+			m_sweep_node = timeline.declare("continuous collisions", this);
+		}
+
+		// bodies with a collisions component of this category get swept.
+		void enable_category(uint64_t category) {
+			if (std::find(m_categories.begin(), m_categories.end(), category) == m_categories.end())
+				m_categories.emplace_back(category);
+		}
+
+		// bodies of this category don't move, like sleeping ones. swept bodies are stopped at them too.
+		void enable_obstacle_category(uint64_t category) {
+			if (std::find(m_obstacle_categories.begin(), m_obstacle_categories.end(), category) == m_obstacle_categories.end())
+				m_obstacle_categories.emplace_back(category);
+		}
+
+		// main thread, before the frame's motion updates.
+		void begin_frame(rynx::ecs& ecs) {
+			m_bodies.clear();
+			if (!m_config.enabled || m_categories.empty())
+				return;
+
+			auto ids = ecs.query().in<rynx::components::motion, rynx::components::radius>().ids_if([this](const rynx::components::collisions& c) {
+				return std::find(m_categories.begin(), m_categories.end(), c.category) != m_categories.end();
+			});
+
+			for (auto id : ids) {
+				const auto& pos = ecs[id].get<const rynx::components::position>();
+				m_bodies.push_back({ id, pos.value.x, pos.value.y, ecs[id].get<const rynx::components::radius>().r });
+			}
+
+			if (m_obstacle_categories.empty())
+				return;
+
+			auto obstacles = ecs.query().in<rynx::components::radius>().notIn<rynx::components::motion>().ids_if([this](const rynx::components::collisions& c) {
+				return std::find(m_obstacle_categories.begin(), m_obstacle_categories.end(), c.category) != m_obstacle_categories.end();
+			});
+
+			for (auto id : obstacles) {
+				const auto& pos = ecs[id].get<const rynx::components::position>();
+				body_path body{ id, pos.value.x, pos.value.y, ecs[id].get<const rynx::components::radius>().r };
+				body.x1 = body.x0;
+				body.y1 = body.y0;
+				body.obstacle = true;
+				m_bodies.push_back(body);
+			}
+		}
+
+		virtual void onFrameProcess(rynx::scheduler::context& context, float) override {
+			context.add_task("continuous collisions", [this](rynx::ecs::view<rynx::components::position> ecs) {
+				auto timing = m_timeline.record(m_sweep_node);
+				if (m_bodies.empty())
+					return;
+
+				// paths of this frame, only fast movers are swept.
+				m_fast.clear();
+				for (uint32_t i = 0; i < m_bodies.size(); ++i) {
+					auto& body = m_bodies[i];
+					if (!ecs.exists(body.id)) {
+						body.radius = -1.0f;
+						continue;
+					}
+					if (body.obstacle)
+						continue;
+
+					const auto& pos = ecs[body.id].get<const rynx::components::position>();
+					body.x1 = pos.value.x;
+					body.y1 = pos.value.y;
+					body.toi = 1.0f;
+					float dx = body.x1 - body.x0;
+					float dy = body.y1 - body.y0;
+					if (dx * dx + dy * dy > sqr(body.radius * m_config.min_travel))
+						m_fast.emplace_back(i);
+				}
+
+				if (m_fast.empty())
+					return;
+
+				m_pool.parallel_for(m_fast.size(), 16, [this](size_t, size_t begin, size_t end) {
+					for (size_t k = begin; k < end; ++k)
+						sweep_static(m_bodies[m_fast[k]]);
+				});
+
+				sweep_bodies();
+
+				for (const auto& body : m_bodies) {
+					if (body.toi >= 1.0f || body.radius < 0.0f || body.obstacle)
+						continue;
+					auto& pos = ecs[body.id].get<rynx::components::position>();
+					pos.value.x = body.x0 + (body.x1 - body.x0) * body.toi;
+					pos.value.y = body.y0 + (body.y1 - body.y0) * body.toi;
+				}
+			});
+		}
+
+	private:
+		struct body_path {
+			rynx::ecs::id id;
+			float x0, y0;
+			float radius;
+			float x1 = 0, y1 = 0;
+			float toi = 1.0f; // fraction of the path the body gets to travel this frame.
+			bool obstacle = false; // not moving this frame, never moved back.
+		};
+
+		static float sqr(float v) { return v * v; }
+
+		// earliest t in [0, 1] where a point moving from p by d gets within r of q, or a value above 1.
+		static float sweep_point(float px, float py, float dx, float dy, float qx, float qy, float r) {
+			float fx = px - qx;
+			float fy = py - qy;
+			float a = dx * dx + dy * dy;
+			float b = fx * dx + fy * dy;
+			float c = fx * fx + fy * fy - r * r;
+			if (c <= 0.0f || b >= 0.0f || a <= 0.0f)
+				return 2.0f; // starts inside (left to the narrowphase) or moves away.
+			float discriminant = b * b - a * c;
+			if (discriminant < 0.0f)
+				return 2.0f;
+			return (-b - std::sqrt(discriminant)) / a;
+		}
+
+		// time of impact as a fraction of the path where the body is `penetration` of its radius inside.
+		float contact_time(float first_touch, float travel) const {
+			if (travel <= 0.0f)
+				return first_touch;
+			return std::min(1.0f, first_touch + m_config.penetration / travel);
+		}
+
+		void sweep_static(body_path& body) {
+			float dx = body.x1 - body.x0;
+			float dy = body.y1 - body.y0;
+			float r = body.radius;
+			float min_x = std::min(body.x0, body.x1) - r;
+			float max_x = std::max(body.x0, body.x1) + r;
+			float min_y = std::min(body.y0, body.y1) - r;
+			float max_y = std::max(body.y0, body.y1) + r;
+
+			float best = 2.0f;
+			m_terrain.for_each_near(min_x, min_y, max_x, max_y, [&](const static_outline::segment& s) {
+				// segment interior, against the line offset by r towards the side the body starts on.
+				float ex = s.bx - s.ax;
+				float ey = s.by - s.ay;
+				float length = std::sqrt(ex * ex + ey * ey);
+				if (length > 0.0f) {
+					float nx = -ey / length;
+					float ny = ex / length;
+					float d0 = (body.x0 - s.ax) * nx + (body.y0 - s.ay) * ny;
+					float d1 = (body.x1 - s.ax) * nx + (body.y1 - s.ay) * ny;
+					if (d0 < 0.0f) {
+						d0 = -d0;
+						d1 = -d1;
+					}
+					if (d0 > r && d1 < r) {
+						float t = (d0 - r) / (d0 - d1);
+						float cx = body.x0 + dx * t - s.ax;
+						float cy = body.y0 + dy * t - s.ay;
+						float u = (cx * ex + cy * ey) / (length * length);
+						if (u >= 0.0f && u <= 1.0f)
+							best = std::min(best, t);
+					}
+				}
+
+				// segment end points.
+				best = std::min(best, sweep_point(body.x0, body.y0, dx, dy, s.ax, s.ay, r));
+				best = std::min(best, sweep_point(body.x0, body.y0, dx, dy, s.bx, s.by, r));
+			});
+
+			if (best <= 1.0f) {
+				float travel = std::sqrt(dx * dx + dy * dy) / std::max(r, 1e-4f);
+				body.toi = std::min(body.toi, contact_time(best, travel));
+			}
+		}
+
+		// swept sphere against sphere for pairs with at least one fast body, sort and sweep on x.
+		void sweep_bodies() {
+			m_order.clear();
+			for (uint32_t i = 0; i < m_bodies.size(); ++i) {
+				const auto& b = m_bodies[i];
+				if (b.radius >= 0.0f)
+					m_order.emplace_back(i);
+			}
+
+			auto min_x = [this](uint32_t i) { const auto& b = m_bodies[i]; return std::min(b.x0, b.x1) - b.radius; };
+			auto max_x = [this](uint32_t i) { const auto& b = m_bodies[i]; return std::max(b.x0, b.x1) + b.radius; };
+			std::sort(m_order.begin(), m_order.end(), [&](uint32_t a, uint32_t b) { return min_x(a) < min_x(b); });
+
+			m_is_fast.assign(m_bodies.size(), 0);
+			for (uint32_t i : m_fast)
+				m_is_fast[i] = 1;
+
+			for (size_t a = 0; a < m_order.size(); ++a) {
+				uint32_t i = m_order[a];
+				float end_x = max_x(i);
+				for (size_t b = a + 1; b < m_order.size() && min_x(m_order[b]) <= end_x; ++b) {
+					uint32_t j = m_order[b];
+					if (!m_is_fast[i] && !m_is_fast[j])
+						continue;
+
+					auto& p = m_bodies[i];
+					auto& q = m_bodies[j];
+					float rx = (p.x1 - p.x0) - (q.x1 - q.x0);
+					float ry = (p.y1 - p.y0) - (q.y1 - q.y0);
+					float t = sweep_point(p.x0, p.y0, rx, ry, q.x0, q.y0, p.radius + q.radius);
+					if (t > 1.0f)
+						continue;
+
+					float travel = std::sqrt(rx * rx + ry * ry) / std::max(p.radius + q.radius, 1e-4f);
+					float toi = contact_time(t, travel);
+					p.toi = std::min(p.toi, toi);
+					q.toi = std::min(q.toi, toi);
+				}
+			}
+		}
+
+		job_pool& m_pool;
+		task_timeline& m_timeline;
+		task_timeline::node m_sweep_node;
+		const static_outline& m_terrain;
+		continuous_collision_config m_config;
+
+		std::vector<uint64_t> m_categories;
+		std::vector<uint64_t> m_obstacle_categories;
+
+		std::vector<body_path> m_bodies;
+		std::vector<uint32_t> m_fast;
+		std::vector<uint32_t> m_order;
+		std::vector<uint8_t> m_is_fast;
+	};
+}
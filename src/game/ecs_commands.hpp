@@ -0,0 +1,141 @@
+
+#pragma once
+
+#include <rynx/tech/ecs.hpp>
+#include <rynx/tech/components.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "cached_query.hpp"
+#include "frame_arena.hpp"
+#include "per_thread.hpp"
+
+namespace game {
+
+	// structural ecs changes (create, attach, remove, erase) recorded by tasks that only hold narrow
+	// ecs::view access, so they don't need exclusive access to the whole ecs.
+	// recordings are played back on the main thread once the frame tasks have completed. playback is
+	// ordered by channel and then by recording order within the channel, so the end result does not
+	// depend on which worker ran which task. only one task per frame may record into a given channel.
+	// there is one ecs_commands per ecs, several of them can record during the same frame.
+	class ecs_commands {
+	public:
+		ecs_commands(component_versions& versions) : m_versions(versions) {}
+
+		ecs_commands(const ecs_commands&) = delete;
+		ecs_commands& operator = (const ecs_commands&) = delete;
+
+		class recorder {
+		public:
+			recorder(ecs_commands& owner, uint32_t channel) : m_owner(&owner), m_channel(channel) {}
+
+			template<typename... Ts>
+			void create(Ts&&... components) {
+				record([components = std::make_tuple(std::forward<Ts>(components)...)](rynx::ecs& ecs, component_versions& versions) mutable {
+					std::apply([&ecs](auto&... cs) { ecs.create(std::move(cs)...); }, components);
+					versions.touch<Ts...>();
+				});
+			}
+
+			template<typename... Ts>
+			void attach(rynx::ecs::id id, Ts&&... components) {
+				record([id, components = std::make_tuple(std::forward<Ts>(components)...)](rynx::ecs& ecs, component_versions& versions) mutable {
+					std::apply([&ecs, id](auto&... cs) { ecs.attachToEntity(id, std::move(cs)...); }, components);
+					versions.touch<Ts...>();
+				});
+			}
+
+			template<typename... Ts>
+			void remove(rynx::ecs::id id) {
+				record([id](rynx::ecs& ecs, component_versions& versions) {
+					ecs.removeFromEntity<Ts...>(id);
+					versions.touch<Ts...>();
+				});
+			}
+
+			// erased entities go through the regular dead entity clean up,
+			// so collision detection and rulesets get notified as usual.
+			void erase(rynx::ecs::id id) {
+				attach(id, rynx::components::dead());
+			}
+
+			// arbitrary follow up work with the full ecs, for example creating an entity
+			// and storing its id in a component of another entity.
+			// the touched component types are not known, so all cached queries are invalidated.
+			template<typename F>
+			void then(F&& op) {
+				record([op = std::forward<F>(op)](rynx::ecs& ecs, component_versions& versions) mutable {
+					op(ecs);
+					versions.touch_all();
+				});
+			}
+
+		private:
+			template<typename F>
+			void record(F&& op) {
+				using command_t = command<std::decay_t<F>>;
+				void* memory = frame_arena::local().allocate(sizeof(command_t), alignof(command_t));
+				command_base* cmd = new (memory) command_t(std::forward<F>(op));
+				per_thread<stream>::local().entries.push_back({ m_owner, m_channel, m_sequence++, cmd });
+			}
+
+			ecs_commands* m_owner = nullptr;
+			uint32_t m_channel = 0;
+			uint32_t m_sequence = 0;
+		};
+
+		// applies what was recorded for this ecs_commands, recordings of others are left in place.
+		// must be called from the main thread while no tasks are running,
+		// and before frame arenas are reset for the next frame.
+		void playback(rynx::ecs& ecs) {
+			per_thread<stream>::for_each([this](stream& s) {
+				auto mine = std::stable_partition(s.entries.begin(), s.entries.end(), [this](const entry& e) { return e.owner != this; });
+				m_queue.insert(m_queue.end(), mine, s.entries.end());
+				s.entries.erase(mine, s.entries.end());
+			});
+
+			std::sort(m_queue.begin(), m_queue.end(), [](const entry& a, const entry& b) {
+				return a.channel != b.channel ? a.channel < b.channel : a.sequence < b.sequence;
+			});
+
+			for (auto& e : m_queue) {
+				e.cmd->execute(ecs, m_versions);
+				e.cmd->~command_base();
+			}
+			m_queue.clear();
+		}
+
+	private:
+		struct command_base {
+			virtual ~command_base() {}
+			virtual void execute(rynx::ecs& ecs, component_versions& versions) = 0;
+		};
+
+		template<typename F>
+		struct command : public command_base {
+			template<typename Op> command(Op&& op) : m_op(std::forward<Op>(op)) {}
+			void execute(rynx::ecs& ecs, component_versions& versions) override { m_op(ecs, versions); }
+			F m_op;
+		};
+
+		struct entry {
+			ecs_commands* owner;
+			uint32_t channel;
+			uint32_t sequence;
+			command_base* cmd;
+		};
+
+		struct stream {
+			std::vector<entry> entries;
+		};
+
+		component_versions& m_versions;
+		std::vector<entry> m_queue;
+	};
+}
@@ -0,0 +1,103 @@
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "per_thread.hpp"
+
+namespace game {
+
+	// bump allocator for temporaries that live at most until the end of the frame.
+	// every thread gets its own arena, so workers never contend on malloc for frame data.
+	// all arenas are reset together with frame_arena::start_frame(), which must only be called
+	// while no tasks are running (right before the scheduler starts the next frame).
+	class frame_arena {
+	public:
+		static constexpr size_t default_block_size = 64 * 1024;
+
+		void* allocate(size_t bytes, size_t alignment) {
+			if (!m_blocks.empty()) {
+				if (void* p = m_blocks.back().allocate(bytes, alignment))
+					return p;
+			}
+
+			size_t block_size = default_block_size;
+			while (block_size < bytes + alignment)
+				block_size *= 2;
+
+			m_blocks.emplace_back(block_size);
+			return m_blocks.back().allocate(bytes, alignment);
+		}
+
+		// if last frame needed more than one block, they are merged into one big enough for all of it.
+		void reset() {
+			if (m_blocks.size() > 1) {
+				size_t total = 0;
+				for (auto& block : m_blocks)
+					total += block.size;
+
+				m_blocks.clear();
+				m_blocks.emplace_back(total);
+			}
+			else if (!m_blocks.empty()) {
+				m_blocks.back().used = 0;
+			}
+		}
+
+		// arena of the calling thread.
+		static frame_arena& local() {
+			return per_thread<frame_arena>::local();
+		}
+
+		static void start_frame() {
+			per_thread<frame_arena>::for_each([](frame_arena& arena) { arena.reset(); });
+		}
+
+	private:
+		struct block {
+			block(size_t bytes) : memory(new std::byte[bytes]), size(bytes) {}
+
+			void* allocate(size_t bytes, size_t alignment) {
+				uintptr_t base = reinterpret_cast<uintptr_t>(memory.get());
+				uintptr_t begin = (base + used + alignment - 1) & ~(uintptr_t(alignment) - 1);
+				if (begin + bytes > base + size)
+					return nullptr;
+
+				used = begin + bytes - base;
+				return reinterpret_cast<void*>(begin);
+			}
+
+			std::unique_ptr<std::byte[]> memory;
+			size_t size = 0;
+			size_t used = 0;
+		};
+
+		std::vector<block> m_blocks;
+	};
+
+	// std allocator handing out memory from the calling thread's frame arena.
+	// deallocation is a no-op, everything is released at the start of the next frame.
+	template<typename T>
+	class frame_allocator {
+	public:
+		using value_type = T;
+
+		frame_allocator() = default;
+		template<typename U> frame_allocator(const frame_allocator<U>&) {}
+
+		T* allocate(size_t n) {
+			return static_cast<T*>(frame_arena::local().allocate(n * sizeof(T), alignof(T)));
+		}
+
+		void deallocate(T*, size_t) {}
+
+		template<typename U> bool operator == (const frame_allocator<U>&) const { return true; }
+		template<typename U> bool operator != (const frame_allocator<U>&) const { return false; }
+	};
+
+	template<typename T>
+	using frame_vector = std::vector<T, frame_allocator<T>>;
+}
@@ -0,0 +1,15 @@
+
+#pragma once
+
+#include <cstdint>
+
+namespace game {
+
+	// per frame values are read by tasks from here instead of being captured when the tasks are created.
+	// this way task bodies are the same every frame, only the clock is rebound.
+	struct frame_clock {
+		float dt = 1.0f / 120.0f;
+		uint64_t frame = 0;
+		double time = 0; // simulated seconds at the start of the frame
+	};
+}
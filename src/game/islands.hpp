@@ -0,0 +1,327 @@
+
+#pragma once
+
+#include <rynx/tech/collision_detection.hpp>
+#include <rynx/tech/components.hpp>
+#include <rynx/tech/ecs.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+#include "cached_query.hpp"
+#include "contact_events.hpp"
+
+namespace game {
+
+	// body of an island that has come to rest. sleeping bodies have no motion component, so they are not
+	// integrated, and they sit in their own collision category, out of the dynamic one. that category must be
+	// detect only towards everything awake (ignore_collisions), like static terrain, so the physics never
+	// reads or writes the motion they don't have.
+	struct sleeping {
+		uint32_t island = 0;
+	};
+
+	struct sleep_config {
+		bool enabled = true;
+		float linear_speed = 2.0f; // bodies slower than this count as resting
+		float angular_speed = 0.25f;
+		float time_to_sleep = 1.0f; // every body of an island has to rest this long before it sleeps
+	};
+
+	class disjoint_sets {
+	public:
+		void reset(size_t count) {
+			m_parent.resize(count);
+			std::iota(m_parent.begin(), m_parent.end(), uint32_t(0));
+			m_rank.assign(count, 0);
+		}
+
+		uint32_t find(uint32_t i) {
+			while (m_parent[i] != i) {
+				m_parent[i] = m_parent[m_parent[i]];
+				i = m_parent[i];
+			}
+			return i;
+		}
+
+		void join(uint32_t a, uint32_t b) {
+			a = find(a);
+			b = find(b);
+			if (a == b)
+				return;
+			if (m_rank[a] < m_rank[b])
+				std::swap(a, b);
+			m_parent[b] = a;
+			m_rank[a] += m_rank[a] == m_rank[b];
+		}
+
+	private:
+		std::vector<uint32_t> m_parent;
+		std::vector<uint8_t> m_rank;
+	};
+
+	// groups awake bodies into islands connected by joints and contacts and puts islands to sleep once all
+	// their bodies have rested for a while. a resting island touching sleeping ones joins them when it falls
+	// asleep. an island wakes up as a whole when a moving body touches one of its bodies, when a joint
+	// connects it to an awake body, or through wake(). bodies passed to keep_awake() don't fall asleep.
+	// main thread only, while no frame tasks are running.
+	class island_sleeping {
+	public:
+		island_sleeping(component_versions& versions, rynx::collision_detection& detection, uint64_t awake_category, uint64_t sleeping_category, sleep_config config = {})
+			: m_versions(versions), m_detection(detection), m_joints(versions), m_awake_category(awake_category), m_sleeping_category(sleeping_category), m_config(config) {}
+
+		void update(rynx::ecs& ecs, const contact_events& contacts, float dt) {
+			if (!m_config.enabled) {
+				m_restless.clear();
+				return;
+			}
+
+			std::sort(m_restless.begin(), m_restless.end());
+			wake_touched_islands(ecs, contacts);
+
+			// only awake dynamic bodies take part, sleeping islands are not looked at again until woken.
+			uint64_t awake = m_awake_category;
+			m_bodies = ecs.query().in<rynx::components::motion, rynx::components::physical_body>().ids_if([awake](const rynx::components::collisions& c) {
+				return c.category == awake;
+			});
+
+			m_index.clear();
+			for (uint32_t i = 0; i < m_bodies.size(); ++i)
+				m_index.emplace(m_bodies[i].value, i);
+			m_sets.reset(m_bodies.size());
+
+			for (auto id : m_joints.ids(ecs)) {
+				const auto& joint = ecs[id].get<const rynx::components::phys::joint>();
+				auto a = m_index.find(joint.id_a);
+				auto b = m_index.find(joint.id_b);
+				if (a != m_index.end() && b != m_index.end()) {
+					m_sets.join(a->second, b->second);
+					continue;
+				}
+
+				// an awake body pulling on a sleeping one. the awake side has to rest again before either sleeps.
+				if (a == m_index.end() && b == m_index.end())
+					continue;
+				auto puller = (a != m_index.end()) ? a : b;
+				rynx::ecs::id other = (a != m_index.end()) ? rynx::ecs::id(joint.id_b) : rynx::ecs::id(joint.id_a);
+				if (ecs.exists(other) && ecs[other].has<sleeping>()) {
+					wake(ecs, other);
+					m_rest[puller->first] = 0.0f;
+				}
+			}
+
+			// touching awake bodies form one island. awake bodies resting against a sleeping island are
+			// remembered, their island joins it if it falls asleep.
+			m_touching.clear();
+			contacts.query().for_each([this, &ecs](const contact_event& event) {
+				auto a = m_index.find(event.a.value);
+				auto b = m_index.find(event.b.value);
+				if (a != m_index.end() && b != m_index.end()) {
+					m_sets.join(a->second, b->second);
+					return;
+				}
+				if (a == m_index.end() && b == m_index.end())
+					return;
+				auto toucher = (a != m_index.end()) ? a : b;
+				rynx::ecs::id other = event.other(rynx::ecs::id(toucher->first));
+				if (ecs.exists(other) && ecs[other].has<sleeping>())
+					m_touching.emplace_back(toucher->second, ecs[other].get<const sleeping>().island);
+			});
+
+			// rest timers, an island is as restless as its most restless body.
+			float linear_limit = m_config.linear_speed * m_config.linear_speed;
+			m_island_rest.assign(m_bodies.size(), m_config.time_to_sleep);
+			for (uint32_t i = 0; i < m_bodies.size(); ++i) {
+				const auto& m = ecs[m_bodies[i]].get<const rynx::components::motion>();
+				float& rest = m_rest[m_bodies[i].value];
+				bool resting = m.velocity.length_squared() < linear_limit && std::abs(m.angularVelocity) < m_config.angular_speed &&
+					!std::binary_search(m_restless.begin(), m_restless.end(), m_bodies[i].value);
+				rest = resting ? rest + dt : 0.0f;
+
+				uint32_t root = m_sets.find(i);
+				m_island_rest[root] = std::min(m_island_rest[root], rest);
+			}
+
+			m_restless.clear();
+			m_falling_asleep.clear();
+			for (uint32_t i = 0; i < m_bodies.size(); ++i) {
+				uint32_t root = m_sets.find(i);
+				if (m_island_rest[root] >= m_config.time_to_sleep)
+					m_falling_asleep.emplace_back(root, i);
+			}
+
+			if (m_falling_asleep.empty())
+				return;
+
+			// sleeping islands touched by a group that falls asleep now become one island with it.
+			m_joining.clear();
+			for (auto [body, island] : m_touching) {
+				uint32_t root = m_sets.find(body);
+				if (m_island_rest[root] < m_config.time_to_sleep)
+					continue;
+				island = resolve(island);
+				if (m_islands.find(island) == m_islands.end())
+					continue;
+				auto it = m_joining.find(root);
+				if (it == m_joining.end())
+					m_joining.emplace(root, island);
+				else if (it->second != island)
+					merge_islands(ecs, it->second, island);
+			}
+
+			std::sort(m_falling_asleep.begin(), m_falling_asleep.end());
+			for (size_t begin = 0; begin < m_falling_asleep.size();) {
+				size_t end = begin;
+				auto joining = m_joining.find(m_falling_asleep[begin].first);
+				uint32_t island = joining != m_joining.end() ? resolve(joining->second) : m_next_island++;
+				auto& members = m_islands[island];
+				while (end < m_falling_asleep.size() && m_falling_asleep[end].first == m_falling_asleep[begin].first) {
+					rynx::ecs::id id = m_bodies[m_falling_asleep[end].second];
+					members.emplace_back(id);
+					m_rest.erase(id.value);
+					ecs.removeFromEntity<rynx::components::motion>(id);
+					ecs.attachToEntity(id, sleeping{ island });
+					set_category(ecs, id, m_sleeping_category);
+					++end;
+					++m_sleeping_bodies;
+				}
+				begin = end;
+			}
+			m_renamed.clear();
+			m_versions.touch<rynx::components::motion, sleeping, rynx::components::collisions>();
+		}
+
+		// explicit wake up, for example when the player applies thrust. wakes the whole island of the body.
+		void wake(rynx::ecs& ecs, rynx::ecs::id body) {
+			if (!ecs.exists(body) || !ecs[body].has<sleeping>())
+				return;
+
+			auto it = m_islands.find(ecs[body].get<const sleeping>().island);
+			if (it == m_islands.end())
+				return;
+
+			for (auto id : it->second) {
+				if (!ecs.exists(id) || !ecs[id].has<sleeping>())
+					continue;
+				ecs.removeFromEntity<sleeping>(id);
+				ecs.attachToEntity(id, rynx::components::motion());
+				set_category(ecs, id, m_awake_category);
+			}
+			m_sleeping_bodies -= it->second.size();
+			m_islands.erase(it);
+			m_versions.touch<rynx::components::motion, sleeping, rynx::components::collisions>();
+		}
+
+		// the body's island keeps awake through the next update, even if nothing moves.
+		// for bodies something outside the physics is about to touch the motion of, like running engines.
+		void keep_awake(rynx::ecs::id body) {
+			m_restless.emplace_back(body.value);
+		}
+
+		void entities_erased(const std::vector<rynx::ecs::id>& ids) {
+			for (auto id : ids)
+				m_rest.erase(id.value);
+		}
+
+		// level reset, after the ecs was cleared.
+		void clear() {
+			m_islands.clear();
+			m_rest.clear();
+			m_restless.clear();
+			m_sleeping_bodies = 0;
+		}
+
+		size_t sleeping_islands() const { return m_islands.size(); }
+		size_t sleeping_bodies() const { return m_sleeping_bodies; }
+
+	private:
+		// a sleeping body touched by a moving one wakes its island. sleeping bodies have no velocity,
+		// so the relative velocity of the contact is the velocity of the other side.
+		void wake_touched_islands(rynx::ecs& ecs, const contact_events& contacts) {
+			if (m_islands.empty())
+				return;
+
+			float linear_limit = m_config.linear_speed * m_config.linear_speed;
+			m_hit.clear();
+			contacts.query().category(m_sleeping_category).for_each([this, &ecs, linear_limit](const contact_event& event) {
+				bool a_sleeps = event.category_a == m_sleeping_category;
+				bool b_sleeps = event.category_b == m_sleeping_category;
+				if (a_sleeps == b_sleeps)
+					return;
+
+				rynx::ecs::id toucher = a_sleeps ? event.b : event.a;
+				bool moving = event.relative_velocity.length_squared() >= linear_limit ||
+					std::binary_search(m_restless.begin(), m_restless.end(), toucher.value);
+				if (!moving && ecs.exists(toucher) && ecs[toucher].has<rynx::components::motion>())
+					moving = std::abs(ecs[toucher].get<const rynx::components::motion>().angularVelocity) >= m_config.angular_speed;
+				if (moving)
+					m_hit.emplace_back(a_sleeps ? event.a : event.b);
+			});
+
+			for (auto id : m_hit)
+				wake(ecs, id);
+		}
+
+		// renamed by merge_islands during this update.
+		uint32_t resolve(uint32_t island) const {
+			for (auto it = m_renamed.find(island); it != m_renamed.end(); it = m_renamed.find(island))
+				island = it->second;
+			return island;
+		}
+
+		void merge_islands(rynx::ecs& ecs, uint32_t into, uint32_t from) {
+			into = resolve(into);
+			from = resolve(from);
+			if (into == from)
+				return;
+			auto source = m_islands.find(from);
+			if (source == m_islands.end())
+				return;
+
+			auto& members = m_islands[into];
+			for (auto id : source->second) {
+				if (ecs.exists(id) && ecs[id].has<sleeping>())
+					ecs[id].get<sleeping>().island = into;
+				members.emplace_back(id);
+			}
+			m_islands.erase(source);
+			m_renamed.emplace(from, into);
+		}
+
+		// collision detection only learns about category changes through erase and a fresh collisions component.
+		void set_category(rynx::ecs& ecs, rynx::ecs::id id, uint64_t category) {
+			auto current = ecs[id].get<const rynx::components::collisions>();
+			m_detection.erase(ecs, id.value, current.category);
+			ecs.removeFromEntity<rynx::components::collisions>(id);
+			ecs.attachToEntity(id, rynx::components::collisions{ category });
+		}
+
+		component_versions& m_versions;
+		rynx::collision_detection& m_detection;
+		cached_query<types<rynx::components::phys::joint>> m_joints;
+		uint64_t m_awake_category;
+		uint64_t m_sleeping_category;
+		sleep_config m_config;
+
+		std::unordered_map<uint32_t, std::vector<rynx::ecs::id>> m_islands;
+		std::unordered_map<uint64_t, float> m_rest; // seconds each awake body has been resting
+		uint32_t m_next_island = 1;
+		size_t m_sleeping_bodies = 0;
+
+		// scratch, rebuilt every update.
+		std::vector<rynx::ecs::id> m_bodies;
+		std::vector<rynx::ecs::id> m_hit;
+		std::vector<std::pair<uint32_t, uint32_t>> m_touching; // awake body index, sleeping island it rests on
+		std::unordered_map<uint32_t, uint32_t> m_joining; // root of a group falling asleep, island it joins
+		std::unordered_map<uint32_t, uint32_t> m_renamed; // islands merged away, to the island they joined
+		std::vector<uint64_t> m_restless; // keep_awake() since the last update
+		std::unordered_map<uint64_t, uint32_t> m_index;
+		disjoint_sets m_sets;
+		std::vector<float> m_island_rest;
+		std::vector<std::pair<uint32_t, uint32_t>> m_falling_asleep;
+	};
+}
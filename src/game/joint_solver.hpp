@@ -0,0 +1,382 @@
+
+#pragma once
+
+#include <rynx/application/logic.hpp>
+#include <rynx/tech/components.hpp>
+#include <rynx/tech/ecs.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+#include <vector>
+
+#include "cached_query.hpp"
+#include "parallel.hpp"
+#include "task_timeline.hpp"
+
+namespace game {
+
+	// greedy edge coloring of the joint graph. joints are edges between the two bodies they connect,
+	// no two joints of the same color share a body, so all joints of one color can be solved at the same time.
+	// colors are kept as long as a joint's bodies stay the same, only new and retargeted joints are recolored.
+	class joint_coloring {
+	public:
+		// joints of bodies that already have a joint of every other color end up here and are solved on one thread.
+		static constexpr uint32_t serial_color = 63;
+		static constexpr uint32_t max_colors = serial_color + 1;
+
+		uint32_t assign(uint64_t joint, uint64_t body_a, uint64_t body_b, uint64_t frame) {
+			auto it = m_joints.find(joint);
+			if (it != m_joints.end()) {
+				it->second.seen = frame;
+				if (it->second.body_a == body_a && it->second.body_b == body_b)
+					return it->second.color;
+				release(it->second);
+				m_joints.erase(it);
+			}
+
+			uint64_t used = m_body_colors[body_a] | m_body_colors[body_b];
+			uint32_t color = serial_color;
+			for (uint32_t c = 0; c < serial_color; ++c) {
+				if (!(used & (uint64_t(1) << c))) {
+					color = c;
+					break;
+				}
+			}
+
+			if (color != serial_color) {
+				m_body_colors[body_a] |= uint64_t(1) << color;
+				m_body_colors[body_b] |= uint64_t(1) << color;
+			}
+			m_joints.emplace(joint, entry{ body_a, body_b, color, frame });
+			return color;
+		}
+
+		// frees the colors of joints that were not assigned during the given frame.
+		void remove_unseen(uint64_t frame) {
+			for (auto it = m_joints.begin(); it != m_joints.end();) {
+				if (it->second.seen != frame) {
+					release(it->second);
+					it = m_joints.erase(it);
+				}
+				else {
+					++it;
+				}
+			}
+		}
+
+		void clear() {
+			m_joints.clear();
+			m_body_colors.clear();
+		}
+
+	private:
+		struct entry {
+			uint64_t body_a;
+			uint64_t body_b;
+			uint32_t color;
+			uint64_t seen;
+		};
+
+		void release(const entry& e) {
+			if (e.color == serial_color)
+				return;
+			for (uint64_t body : { e.body_a, e.body_b }) {
+				auto it = m_body_colors.find(body);
+				if (it != m_body_colors.end() && (it->second &= ~(uint64_t(1) << e.color)) == 0)
+					m_body_colors.erase(it);
+			}
+		}
+
+		std::unordered_map<uint64_t, entry> m_joints;
+		std::unordered_map<uint64_t, uint64_t> m_body_colors; // bitmask of colors in use
+	};
+
+	struct joint_solver_config {
+		// velocity iterations per frame. stiff structures of many rods converge better with more.
+		uint32_t iterations = 4;
+		size_t grain_size = 64;
+	};
+
+	// marks joints made by create_rod, the only joints joint_solver accepts.
+	struct solver_rod {};
+
+	// rigid, rotation free connection between two bodies. anchors are in body space.
+	struct rod {
+		rynx::ecs::id a;
+		rynx::ecs::id b;
+		rynx::vec3f point_a;
+		rynx::vec3f point_b;
+		float length = 0;
+		float correction_rate = 25.0f; // fraction of the length error corrected per second
+	};
+
+	inline rynx::ecs::id create_rod(rynx::ecs& ecs, const rod& r) {
+		rynx::components::phys::joint joint;
+		joint.connect_with_rod().rotation_free();
+		joint.id_a = r.a.value;
+		joint.id_b = r.b.value;
+		joint.point_a = r.point_a;
+		joint.point_b = r.point_b;
+		joint.length = r.length;
+		joint.strength = r.correction_rate;
+		return ecs.create(joint, solver_rod{});
+	}
+
+	// solves rod joints as point distance constraints on body velocities, one color batch at a time.
+	// joints and bodies are gathered into flat arrays once per frame, the iterations only touch those.
+	//
+	// this replaces the force model of rynx's springs ruleset, and joint.strength means something else here:
+	// not a spring constant, but the fraction of a rod's length error that is corrected per second.
+	// an impulse based constraint keeps a rod at its length regardless of masses and frame rate, where a stiff
+	// spring needed to hold heavy parts together overshoots. springs and ropes have no place in this model,
+	// so only joints made by create_rod are solved. any other joint trips an assert and is left out, instead
+	// of silently turning into a rod.
+	class joint_solver : public rynx::application::logic::iruleset {
+	public:
+		joint_solver(job_pool& pool, component_versions& versions, task_timeline& timeline, joint_solver_config config = {})
+			: m_pool(pool), m_joints(versions), m_timeline(timeline), m_config(config)
+		{
+			m_solve_node = timeline.declare("solve joints", this);
+		}
+
+		virtual void onFrameProcess(rynx::scheduler::context& context, float dt) override {
+			context.add_task("solve joints", [this, dt](
+				rynx::ecs::view<
+					const rynx::components::phys::joint,
+					const solver_rod,
+					const rynx::components::position,
+					const rynx::components::physical_body,
+					rynx::components::motion> ecs)
+			{
+				auto timing = m_timeline.record(m_solve_node);
+				gather(ecs, dt);
+
+				for (uint32_t iteration = 0; iteration < m_config.iterations; ++iteration) {
+					for (uint32_t color = 0; color < joint_coloring::max_colors; ++color) {
+						size_t begin = m_batch_begin[color];
+						size_t count = m_batch_begin[color + 1] - begin;
+						if (color == joint_coloring::serial_color) {
+							solve(begin, begin + count);
+							continue;
+						}
+
+						m_pool.parallel_for(count, m_config.grain_size, [this, begin](size_t, size_t first, size_t last) {
+							solve(begin + first, begin + last);
+						});
+					}
+				}
+
+				for (size_t i = 0; i < m_body_ids.size(); ++i) {
+					auto& m = ecs[m_body_ids[i]].template get<rynx::components::motion>();
+					m.velocity.x = m_bodies.vx[i];
+					m.velocity.y = m_bodies.vy[i];
+					m.angularVelocity = m_bodies.w[i];
+				}
+			});
+		}
+
+	private:
+		struct body_arrays {
+			std::vector<float> vx, vy, w;
+			std::vector<float> inv_mass, inv_inertia;
+
+			void clear() {
+				vx.clear(); vy.clear(); w.clear();
+				inv_mass.clear(); inv_inertia.clear();
+			}
+		};
+
+		struct joint_arrays {
+			std::vector<uint32_t> a, b;
+			std::vector<float> rax, ray, rbx, rby; // anchor offsets from body centers, world space
+			std::vector<float> nx, ny; // from a to b
+			std::vector<float> bias; // target separation velocity, pulls the rod back to its length
+			std::vector<float> inv_k; // inverse effective mass along n
+
+			void resize(size_t n) {
+				a.resize(n); b.resize(n);
+				rax.resize(n); ray.resize(n); rbx.resize(n); rby.resize(n);
+				nx.resize(n); ny.resize(n);
+				bias.resize(n); inv_k.resize(n);
+			}
+		};
+
+		struct gathered_joint {
+			uint32_t color;
+			uint32_t a, b;
+			float rax, ray, rbx, rby;
+			float nx, ny;
+			float bias;
+			float inv_k;
+		};
+
+		template<typename Ecs>
+		uint32_t body_index(Ecs& ecs, rynx::ecs::id id, rynx::vec3f& center, float& angle) {
+			const auto& pos = ecs[id].template get<const rynx::components::position>();
+			center = pos.value;
+			angle = pos.angle;
+
+			auto [it, inserted] = m_body_lookup.emplace(id.value, uint32_t(m_body_ids.size()));
+			if (inserted) {
+				const auto& m = ecs[id].template get<const rynx::components::motion>();
+				const auto& body = ecs[id].template get<const rynx::components::physical_body>();
+				m_body_ids.emplace_back(id);
+				m_bodies.vx.emplace_back(m.velocity.x);
+				m_bodies.vy.emplace_back(m.velocity.y);
+				m_bodies.w.emplace_back(m.angularVelocity);
+				m_bodies.inv_mass.emplace_back(body.inv_mass);
+				m_bodies.inv_inertia.emplace_back(body.inv_moment_of_inertia);
+			}
+			return it->second;
+		}
+
+		template<typename Ecs>
+		void gather(Ecs& ecs, float dt) {
+			const auto& ids = m_joints.ids(ecs);
+			++m_frame;
+
+			m_body_lookup.clear();
+			m_body_ids.clear();
+			m_bodies.clear();
+			m_gathered.clear();
+
+			auto usable = [&ecs](rynx::ecs::id id) {
+				return ecs.exists(id) &&
+					ecs[id].template has<rynx::components::position>() &&
+					ecs[id].template has<rynx::components::motion>() &&
+					ecs[id].template has<rynx::components::physical_body>();
+			};
+
+			for (auto id : ids) {
+				if (!ecs[id].template has<solver_rod>()) {
+					rynx_assert(false, "joint_solver only solves joints made by create_rod");
+					if (!m_warned_rejected) {
+						std::fprintf(stderr, "joint solver: joint %llu was not made by create_rod, it is not solved\n", static_cast<unsigned long long>(id.value));
+						m_warned_rejected = true;
+					}
+					continue;
+				}
+
+				const auto& joint = ecs[id].template get<const rynx::components::phys::joint>();
+				rynx::ecs::id id_a(joint.id_a);
+				rynx::ecs::id id_b(joint.id_b);
+				if (!usable(id_a) || !usable(id_b))
+					continue;
+
+				gathered_joint j;
+				j.color = m_coloring.assign(id.value, id_a.value, id_b.value, m_frame);
+
+				rynx::vec3f center_a, center_b;
+				float angle_a, angle_b;
+				j.a = body_index(ecs, id_a, center_a, angle_a);
+				j.b = body_index(ecs, id_b, center_b, angle_b);
+
+				rynx::vec3f ra = rynx::math::rotatedXY(joint.point_a, angle_a);
+				rynx::vec3f rb = rynx::math::rotatedXY(joint.point_b, angle_b);
+				float dx = (center_b.x + rb.x) - (center_a.x + ra.x);
+				float dy = (center_b.y + rb.y) - (center_a.y + ra.y);
+				float length = std::sqrt(dx * dx + dy * dy);
+				if (length < 1e-6f)
+					continue;
+
+				j.rax = ra.x; j.ray = ra.y;
+				j.rbx = rb.x; j.rby = rb.y;
+				j.nx = dx / length;
+				j.ny = dy / length;
+
+				float ra_n = ra.x * j.ny - ra.y * j.nx;
+				float rb_n = rb.x * j.ny - rb.y * j.nx;
+				float k =
+					m_bodies.inv_mass[j.a] + m_bodies.inv_mass[j.b] +
+					m_bodies.inv_inertia[j.a] * ra_n * ra_n +
+					m_bodies.inv_inertia[j.b] * rb_n * rb_n;
+				if (k <= 0.0f)
+					continue;
+				j.inv_k = 1.0f / k;
+
+				// strength is how much of the length error is corrected per second, at most all of it in one step.
+				float correction = std::clamp(joint.strength * dt, 0.0f, 1.0f);
+				j.bias = correction * (length - joint.length) / std::max(dt, 1e-4f);
+				m_gathered.emplace_back(j);
+			}
+
+			if (m_joints.version() != m_swept_version) {
+				m_coloring.remove_unseen(m_frame);
+				m_swept_version = m_joints.version();
+			}
+
+			// lay joints out by color, each color is one contiguous batch.
+			std::array<size_t, joint_coloring::max_colors> counts{};
+			for (const auto& j : m_gathered)
+				++counts[j.color];
+
+			m_batch_begin[0] = 0;
+			for (uint32_t c = 0; c < joint_coloring::max_colors; ++c)
+				m_batch_begin[c + 1] = m_batch_begin[c] + counts[c];
+
+			auto next = m_batch_begin;
+			m_soa.resize(m_gathered.size());
+			for (const auto& j : m_gathered) {
+				size_t i = next[j.color]++;
+				m_soa.a[i] = j.a; m_soa.b[i] = j.b;
+				m_soa.rax[i] = j.rax; m_soa.ray[i] = j.ray;
+				m_soa.rbx[i] = j.rbx; m_soa.rby[i] = j.rby;
+				m_soa.nx[i] = j.nx; m_soa.ny[i] = j.ny;
+				m_soa.bias[i] = j.bias;
+				m_soa.inv_k[i] = j.inv_k;
+			}
+		}
+
+		// joints within [begin, end) of one color batch never share a body.
+		void solve(size_t begin, size_t end) {
+			auto& body = m_bodies;
+			const auto& j = m_soa;
+			for (size_t i = begin; i < end; ++i) {
+				uint32_t a = j.a[i];
+				uint32_t b = j.b[i];
+
+				// relative velocity of the anchor points along the rod.
+				float vax = body.vx[a] - body.w[a] * j.ray[i];
+				float vay = body.vy[a] + body.w[a] * j.rax[i];
+				float vbx = body.vx[b] - body.w[b] * j.rby[i];
+				float vby = body.vy[b] + body.w[b] * j.rbx[i];
+				float v_n = (vbx - vax) * j.nx[i] + (vby - vay) * j.ny[i];
+
+				float impulse = -(v_n + j.bias[i]) * j.inv_k[i];
+				float px = impulse * j.nx[i];
+				float py = impulse * j.ny[i];
+
+				body.vx[a] -= px * body.inv_mass[a];
+				body.vy[a] -= py * body.inv_mass[a];
+				body.w[a] -= (j.rax[i] * py - j.ray[i] * px) * body.inv_inertia[a];
+
+				body.vx[b] += px * body.inv_mass[b];
+				body.vy[b] += py * body.inv_mass[b];
+				body.w[b] += (j.rbx[i] * py - j.rby[i] * px) * body.inv_inertia[b];
+			}
+		}
+
+		job_pool& m_pool;
+		cached_query<types<rynx::components::phys::joint>> m_joints;
+		task_timeline& m_timeline;
+		task_timeline::node m_solve_node;
+		joint_solver_config m_config;
+
+		joint_coloring m_coloring;
+		uint64_t m_frame = 0;
+		bool m_warned_rejected = false;
+		uint64_t m_swept_version = 0;
+
+		std::unordered_map<uint64_t, uint32_t> m_body_lookup;
+		std::vector<rynx::ecs::id> m_body_ids;
+		body_arrays m_bodies;
+
+		std::vector<gathered_joint> m_gathered;
+		joint_arrays m_soa;
+		std::array<size_t, joint_coloring::max_colors + 1> m_batch_begin{};
+	};
+}
@@ -20,7 +20,6 @@
 
 #include <rynx/rulesets/frustum_culling.hpp>
 #include <rynx/rulesets/motion.hpp>
-#include <rynx/rulesets/physics/springs.hpp>
 #include <rynx/rulesets/collisions.hpp>
 #include <rynx/rulesets/particles.hpp>
 
@@ -35,12 +34,38 @@
 #include <rynx/scheduler/task_scheduler.hpp>
 
 #include <iostream>
+#include <fstream>
+#include <array>
 #include <thread>
+#include <string_view>
+#include <unordered_map>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <type_traits>
 
 #include <cmath>
 
 #include <rynx/audio/audio.hpp>
 
+#include "ballistic_particles.hpp"
+#include "cached_query.hpp"
+#include "contact_events.hpp"
+#include "continuous_collisions.hpp"
+#include "ecs_commands.hpp"
+#include "frame_arena.hpp"
+#include "frame_clock.hpp"
+#include "islands.hpp"
+#include "joint_solver.hpp"
+#include "mesh_lod.hpp"
+#include "parallel.hpp"
+#include "ruleset_graph.hpp"
+#include "state_stream.hpp"
+#include "static_outline.hpp"
+#include "task_timeline.hpp"
+#include "update_lod.hpp"
+
 template<typename T>
 struct range {
 	range(T b, T e) : begin(b), end(e) {}
@@ -54,244 +79,396 @@ struct range {
 	}
 };
 
-float g_success_timer = 0;
-
-int main(int argc, char** argv) {
+// accumulates a hash of everything that affects what a cached render target shows.
+// when none of it changed since the previous frame, the target contents can be reused as is.
+class redraw_tracker {
+public:
+	// only scalars, the bytes of structs may include padding that changes without the value changing.
+	template<typename T>
+	redraw_tracker& observe(const T& value) {
+		static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "observe scalars only, structs may contain padding");
+		return observe_bytes(&value, sizeof(T));
+	}
 
-	// uses this thread services of rynx, for example in cpu performance profiling.
-	rynx::this_thread::rynx_thread_raii rynx_thread_services_required_token;
+	redraw_tracker& observe(const std::string& value) {
+		observe(value.size());
+		return observe_bytes(value.data(), value.size());
+	}
 
-	Font fontLenka(Fonts::setFontLenka());
-	Font fontConsola(Fonts::setFontConsolaMono());
+	// menus may still animate for a while after a change without further input,
+	// so keep redrawing until things have settled.
+	bool needs_redraw(float dt) {
+		if (m_hash != m_previous_hash) {
+			m_settle_time = settle_duration;
+		}
+		else {
+			m_settle_time -= dt;
+		}
 
-	rynx::application::Application application;
-	application.openWindow(1920, 1080);
-	application.loadTextures("../textures/textures.txt");
-	application.renderer().loadDefaultMesh("Empty");
+		m_previous_hash = m_hash;
+		m_hash = fnv_offset;
+		return m_settle_time > 0.0f;
+	}
 
-	auto meshes = application.renderer().meshes();
-	{
-		meshes->create("ball", rynx::Shape::makeCircle(1.0f, 32), "Hero");
-		meshes->create("circle_empty", rynx::Shape::makeCircle(1.0f, 32), "Empty");
+private:
+	redraw_tracker& observe_bytes(const void* data, size_t size) {
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		for (size_t i = 0; i < size; ++i) {
+			m_hash = (m_hash ^ bytes[i]) * fnv_prime;
+		}
+		return *this;
 	}
 
-	rynx::scheduler::task_scheduler scheduler;
-	rynx::application::simulation base_simulation(scheduler);
-	rynx::ecs& ecs = base_simulation.m_ecs;
+	static constexpr uint64_t fnv_offset = 14695981039346656037ull;
+	static constexpr uint64_t fnv_prime = 1099511628211ull;
+	static constexpr float settle_duration = 0.5f;
 
-	std::shared_ptr<rynx::camera> camera = std::make_shared<rynx::camera>();
-	camera->setProjection(0.02f, 20000.0f, application.aspectRatio());
+	uint64_t m_hash = fnv_offset;
+	uint64_t m_previous_hash = 0;
+	float m_settle_time = settle_duration;
+};
 
-	rynx::mapped_input gameInput(application.input());
+// ship engines are activated by a bitmask of ship controls.
+namespace ship_control {
+	enum : uint32_t {
+		forward,
+		backward,
+		turn_left,
+		turn_right,
+		count
+	};
 
+	constexpr uint32_t bit(uint32_t control) { return 1u << control; }
+}
 
-	rynx::collision_detection* detection = new rynx::collision_detection();
-	auto& collisionDetection = *detection;
+// playback order of deferred ecs changes. each recording task has a channel of its own.
+namespace command_channel {
+	enum : uint32_t {
+		rocket_destruction,
+		engine_fumes,
+		particle_expiry
+	};
+}
 
-	// setup collision detection
-	rynx::collision_detection::category_id collisionCategoryDynamic = collisionDetection.add_category();
-	rynx::collision_detection::category_id collisionCategoryStatic = collisionDetection.add_category();
-	rynx::collision_detection::category_id collisionCategoryProjectiles = collisionDetection.add_category();
+class sound_mapper {
+public:
+	void insert(std::string name, int value) {
+		m_data[event_id(name)].emplace_back(value);
+	}
 
-	{
-		collisionDetection.enable_collisions_between(collisionCategoryDynamic, collisionCategoryDynamic); // enable dynamic <-> dynamic collisions
-		collisionDetection.enable_collisions_between(collisionCategoryDynamic, collisionCategoryStatic.ignore_collisions()); // enable dynamic <-> static collisions
+	// resolve names once when setting things up, per frame users only deal with event ids.
+	int event_id(const std::string& name) {
+		auto it = m_ids.find(name);
+		if (it != m_ids.end())
+			return it->second;
 
-		collisionDetection.enable_collisions_between(collisionCategoryProjectiles, collisionCategoryStatic.ignore_collisions()); // projectile <-> static
-		collisionDetection.enable_collisions_between(collisionCategoryProjectiles, collisionCategoryDynamic); // projectile <-> dynamic
+		int id = static_cast<int>(m_data.size());
+		m_ids.emplace(name, id);
+		m_data.emplace_back();
+		return id;
 	}
 
-	class sound_mapper {
-	public:
-		void insert(std::string name, int value) {
-			m_data[name].emplace_back(value);
-		}
-
-		int get(const std::string& name) const {
-			auto it = m_data.find(name);
-			if (it != m_data.end()) {
-				if (!it->second.empty()) {
-					return it->second[m_random(it->second.size())];
-				}
+	int get(int event_id) const {
+		if (event_id >= 0 && event_id < static_cast<int>(m_data.size())) {
+			const auto& options = m_data[event_id];
+			if (!options.empty()) {
+				return options[m_random(options.size())];
 			}
-			return 0;
 		}
+		return 0;
+	}
 
-	private:
-		mutable rynx::math::rand64 m_random;
-		rynx::unordered_map<std::string, std::vector<int>> m_data;
-	};
+	int get(const std::string& name) const {
+		auto it = m_ids.find(name);
+		if (it != m_ids.end()) {
+			return get(it->second);
+		}
+		return 0;
+	}
 
-	rynx::sound::audio_system audio;
-	audio.set_default_attentuation_linear(0.01f);
-	audio.set_default_attentuation_quadratic(0.000001f);
-	audio.set_volume(1.0f);
-	audio.adjust_volume(1.5f);
+private:
+	mutable rynx::math::rand64 m_random;
+	rynx::unordered_map<std::string, int> m_ids;
+	std::vector<std::vector<int>> m_data;
+};
 
-	sound_mapper sounds;
+struct player_controlled { int controller_index = 0; };
+struct health {
+	float max = 100;
+	float current = 100;
+};
 
-	// set additional resources your simulation wants to use.
-	{
-		base_simulation.set_resource(&collisionDetection);
-		base_simulation.set_resource(&gameInput);
-		base_simulation.set_resource(&audio);
-		base_simulation.set_resource(&sounds);
+// whole fleet aggregates, reduced over all ship parts once per frame.
+struct fleet_stats {
+	int32_t parts_alive = 0;
+	float steadiness = 0; // sum of squared part velocities
+	float health_current = 0;
+	float health_max = 0;
+	rynx::vec3f position_sum;
+	rynx::vec3f velocity_sum;
+
+	void combine(const fleet_stats& other) {
+		parts_alive += other.parts_alive;
+		steadiness += other.steadiness;
+		health_current += other.health_current;
+		health_max += other.health_max;
+		position_sum += other.position_sum;
+		velocity_sum += other.velocity_sum;
 	}
 
-	struct player_controlled { int controller_index = 0; };
-	struct health {
-		float max = 100;
-		float current = 100;
-	};
+	rynx::vec3f centroid() const { return parts_alive > 0 ? position_sum * (1.0f / parts_alive) : rynx::vec3f(); }
+	rynx::vec3f average_velocity() const { return parts_alive > 0 ? velocity_sum * (1.0f / parts_alive) : rynx::vec3f(); }
+};
 
-	struct ship_engine_state {
-		rynx::ecs::id light_id;
-		
-		// conf
-		rynx::sound::configuration sound_conf;
-		std::string sound_event_name; // "engine" or "steering"
-		std::string activation_sound; // "engine_ignition_boom" or ""
-
-		float direction = 0;
-		float startup_time_multiplier = 0;
-		float power = 0;
-
-		std::vector<rynx::key::logical> activated_by_keys;
-
-		// runtime data
-		float activity = 0;
-		float phase = 0;
-		bool is_roaring = false;
-		bool currently_being_activated = false;
+// mission progress, shared between logic tasks and the main loop.
+struct mission_state {
+	float success_timer = 0;
+	fleet_stats fleet;
+};
+
+const rynx::vec3f world_gravity{ 0, -160.8f, 0 };
+
+// ballistic particle launched at the start of the current frame, fading along the particle_info ranges.
+game::ballistic_particle launch_particle(const rynx::components::particle_info& info, rynx::vec3f origin, rynx::vec3f velocity, rynx::vec3f acceleration, float dampening, double time, float lifetime) {
+	game::ballistic_particle particle;
+	particle.origin = origin;
+	particle.velocity = velocity;
+	particle.acceleration = acceleration;
+	particle.damping = game::ballistic_particle::damping_from(dampening);
+	particle.spawn_time = time;
+	particle.lifetime = lifetime;
+	particle.color_begin = info.color_range.begin;
+	particle.color_end = info.color_range.end;
+	particle.radius_begin = info.radius_range.begin;
+	particle.radius_end = info.radius_range.end;
+	return particle;
+}
+
+// ship controls held down this frame, one bit per ship_control. filled from the keyboard or by an autopilot.
+struct ship_controls {
+	uint32_t down = 0;
+};
+
+// each engine is an entity of its own, attached to its host ship part with position_relative.
+// the hot per engine state is plain data, so all engines can be updated in one dense pass.
+struct ship_engine {
+	enum flags : uint32_t {
+		roaring = 1 << 0,
+		activated = 1 << 1, // a control key mapped to this engine is held down this frame
+		ignited = 1 << 2, // engine reached full power this frame
+		has_activation_sound = 1 << 3,
 	};
 
-	sounds.insert("engine", audio.load("../sound/bass/engine01.ogg"));
-	sounds.insert("engine", audio.load("../sound/bass/engine02.ogg"));
-	sounds.insert("engine", audio.load("../sound/bass/engine03.ogg"));
-	sounds.insert("engine", audio.load("../sound/bass/engine04.ogg"));
-	sounds.insert("engine", audio.load("../sound/bass/engine05.ogg"));
+	rynx::ecs::entity_id_t host = 0;
 
-	sounds.insert("steering", audio.load("../sound/ship/gas_leak01.ogg"));
-	sounds.insert("steering", audio.load("../sound/ship/gas_leak02.ogg"));
-	sounds.insert("steering", audio.load("../sound/ship/gas_leak03.ogg"));
-	sounds.insert("steering", audio.load("../sound/ship/gas_leak04.ogg"));
-	sounds.insert("steering", audio.load("../sound/ship/gas_leak05.ogg"));
+	// conf
+	float direction = 0;
+	float startup_time_multiplier = 0;
+	float power = 0;
+	uint32_t activated_by = 0; // bitmask of ship_control values
 
-	sounds.insert("engine_ignition_boom", audio.load("../sound/engine_boom.ogg"));
-	sounds.insert("rocket_death", audio.load("../sound/death01.ogg"));
-	sounds.insert("rocket_death", audio.load("../sound/death02.ogg"));
-	sounds.insert("rocket_death", audio.load("../sound/death03.ogg"));
-	sounds.insert("rocket_death", audio.load("../sound/death04.ogg"));
+	// runtime data
+	float activity = 0;
+	float phase = 0;
+	float thrust = 0; // acceleration applied to host along engine direction this frame
+	uint32_t state = 0; // bitmask of flags
+};
 
-	class rocket_component_destruction : public rynx::application::logic::iruleset {
-		rynx::math::rand64 random;
+// cold per engine data, only touched for engines that are running.
+struct ship_engine_sound {
+	rynx::sound::configuration conf;
+	int operating_sound = -1; // "engine" or "steering"
+	int activation_sound = -1; // "engine_ignition_boom" or none
+};
 
-		struct burning {};
-		struct fire_lift {
-			float v = 0.0f;
-		};
+class rocket_component_destruction : public rynx::application::logic::iruleset {
+	rynx::math::rand64 random;
+	game::job_pool& m_pool;
+
+	struct burning {};
+
+	game::cached_query<game::types<burning>, game::types<health>> m_burning_debris;
+	game::cached_query<game::types<health, rynx::components::motion>, game::types<>> m_moving_parts;
+	game::cached_query<game::types<health, game::sleeping>, game::types<>> m_resting_parts;
+	game::ecs_commands& m_commands;
+	bool m_visuals = true;
+	game::lod_policy m_debris_lod; // fire of burning debris, parts with health always burn at full rate.
+	rynx::graphics::mesh* m_particle_mesh = nullptr;
+	game::island_sleeping* m_islands = nullptr;
+
+	game::task_timeline& m_timeline;
+	game::task_timeline::node m_check_damage_node;
+	game::task_timeline::node m_destroyed_parts_node;
+	game::task_timeline::node m_explosion_lights_node;
+
+public:
+	// without visuals no sounds are played and no purely visual particles or lights are spawned.
+	rocket_component_destruction(game::job_pool& pool, game::ecs_commands& commands, game::component_versions& versions, game::task_timeline& timeline, bool visuals, game::lod_policy debris_lod, rynx::graphics::mesh* particle_mesh, game::island_sleeping& islands)
+		: m_pool(pool), m_burning_debris(versions), m_moving_parts(versions), m_resting_parts(versions), m_commands(commands), m_visuals(visuals), m_debris_lod(debris_lod), m_particle_mesh(particle_mesh), m_islands(&islands), m_timeline(timeline)
+	{
+		m_check_damage_node = timeline.declare("check rocket damage", this);
+		m_destroyed_parts_node = timeline.declare("rocket react to destroyed parts", this);
+		m_explosion_lights_node = timeline.declare("explosion lights", this);
+		timeline.depends_on(m_destroyed_parts_node, m_check_damage_node);
+	}
 
-		virtual void onFrameProcess(rynx::scheduler::context& context, float dt) override {
-			context.add_task("check rocket damage", [dt](rynx::ecs::view<health, const rynx::components::motion, const rynx::components::collision_custom_reaction> ecs) {
-				static float max_v = -10000000.0f;
-				
-				float steadiness = 0;
-				ecs.query().for_each([&steadiness, dt](health& hp, const rynx::components::collision_custom_reaction& custom, rynx::components::motion m) {
-					steadiness += m.velocity.length_squared();
-					for (const auto& event : custom.events) {
-						float damage = event.relative_velocity.dot(event.normal) - 4.0f;
-						if (damage > 0) {
-							hp.current -= damage * damage * 10.0f;
-						}
+	virtual void onFrameProcess(rynx::scheduler::context& context, float) override {
+		context.add_task("check rocket damage", [this](
+			rynx::ecs::view<
+				health,
+				const rynx::components::position,
+				const rynx::components::motion,
+				const game::sleeping> ecs,
+			const game::contact_events& contacts,
+			mission_state& mission,
+			const game::frame_clock& clock)
+		{
+			auto timing = m_timeline.record(m_check_damage_node);
+			// both sides of a hit take the same damage.
+			contacts.query().for_each([&ecs](const game::contact_event& event) {
+				float damage = event.approach_speed() - 4.0f;
+				if (damage <= 0)
+					return;
+				for (auto id : { event.a, event.b }) {
+					if (ecs.exists(id) && ecs[id].has<health>()) {
+						ecs[id].get<health>().current -= damage * damage * 10.0f;
 					}
-				});
-
-				if (steadiness < 25.0f || g_success_timer >= 2.0f) {
-					g_success_timer += dt;
-				}
-				else {
-					g_success_timer = 0;
 				}
 			});
 
-			context.add_task("rocket react to destroyed parts", [this](rynx::ecs& ecs, rynx::sound::audio_system& audio, const sound_mapper& sounds) {
-				std::vector<rynx::ecs::id> ids = ecs.query().ids_if([](health hp) {
-					return hp.current <= 0.0f;
-				});
-
-				for (auto&& id : ids) {
-					if (ecs[id].has<std::vector<ship_engine_state>>()) {
-						auto engines = ecs[id].get<std::vector<ship_engine_state>>();
-						for (auto& engine : engines) {
-							ecs[engine.light_id].remove<rynx::components::light_omni>();
+			// parts destroyed by now keep their health component until the end of the frame, they are not counted.
+			// parts of a sleeping island have no motion, they are at rest. both id lists are cached, the
+			// workers read the components in place.
+			const auto& moving_parts = m_moving_parts.ids(ecs);
+			const auto& resting_parts = m_resting_parts.ids(ecs);
+			mission.fleet = game::parallel_reduce(m_pool, moving_parts.size() + resting_parts.size(), 1024, fleet_stats(),
+				[&ecs, &moving_parts, &resting_parts](fleet_stats& stats, size_t begin, size_t end) {
+					for (size_t i = begin; i < end; ++i) {
+						bool moving = i < moving_parts.size();
+						auto part = ecs[moving ? moving_parts[i] : resting_parts[i - moving_parts.size()]];
+						const auto& hp = part.get<const health>();
+						if (hp.current <= 0.0f)
+							continue;
+
+						++stats.parts_alive;
+						stats.health_current += hp.current;
+						stats.health_max += hp.max;
+						stats.position_sum += part.get<const rynx::components::position>().value;
+						if (moving) {
+							const auto& m = part.get<const rynx::components::motion>();
+							stats.steadiness += m.velocity.length_squared();
+							stats.velocity_sum += m.velocity;
 						}
-
-						ecs.removeFromEntity<std::vector<ship_engine_state>, health, rynx::components::collision_custom_reaction>(id);
 					}
-					else
-						ecs.removeFromEntity<health, rynx::components::collision_custom_reaction>(id);
+				},
+				[](fleet_stats& result, const fleet_stats& partial) { result.combine(partial); }
+			);
 
+			if (mission.fleet.steadiness < 25.0f || mission.success_timer >= 2.0f) {
+				mission.success_timer += clock.dt;
+			}
+			else {
+				mission.success_timer = 0;
+			}
+		});
+
+		context.add_task("rocket react to destroyed parts", [this](
+			rynx::ecs::view<
+				const health,
+				const ship_engine,
+				const burning,
+				const rynx::components::position,
+				const rynx::components::motion,
+				const rynx::components::collisions,
+				const rynx::components::phys::joint> ecs,
+			rynx::sound::audio_system& audio,
+			const sound_mapper& sounds,
+			const game::frame_clock& clock,
+			const game::lod_view& view)
+		{
+			auto timing = m_timeline.record(m_destroyed_parts_node);
 
-					rynx::components::light_omni fire_light;
-					fire_light.attenuation_quadratic = 1.0f;
-					fire_light.attenuation_linear = 0.0f;
-					fire_light.color = { 1, 1, 1, 10.01f };
-					fire_light.ambient = 0.05f;
-					
-					ecs.attachToEntity(id, burning(), fire_light);
+			// entity creation and component changes are deferred, this task only reads the ecs.
+			game::ecs_commands::recorder commands(m_commands, command_channel::rocket_destruction);
 
+			std::vector<rynx::ecs::id> ids = ecs.query().ids_if([](health hp) {
+				return hp.current <= 0.0f;
+			});
 
-					// explosion particles
-					{
-						rynx::components::position pos = ecs[id].get<const rynx::components::position>();
+			auto contains = [](const auto& vec, rynx::ecs::id id) { bool answer = false; for (auto&& bleb : vec) { answer |= (bleb == id); } return answer; };
 
-						// also play some explosy sound or something. why not.
-						audio.play_sound(sounds.get("rocket_death"), pos.value);
+			// engines of destroyed parts stop working and go dark.
+			auto dead_engines = ecs.query().ids_if([&contains, &ids](const ship_engine& engine) { return contains(ids, engine.host); });
+			for (auto&& id : dead_engines) {
+				commands.remove<ship_engine, ship_engine_sound, rynx::components::light_omni>(id);
+			}
 
-						range<rynx::floats4> start_color{ rynx::floats4{0.5f, 0.3f, 0.0f, 0.3f}, rynx::floats4{0.6f, 0.4f, 0.0f, 0.3f} };
-						range<rynx::floats4> end_color{ rynx::floats4{1.0f, 0.3f, 0.0f, 0.0f}, rynx::floats4{1.0f, 0.6f, 0.1f, 0.0f} };
-						range<float> start_radius{ 2.0f, 3.5f };
-						range<float> end_radius{ 0.0f, 0.1f };
+			for (auto&& id : ids) {
+				commands.remove<health>(id);
 
-						for (int i = 0; i < 1000; ++i) {
-							rynx::components::particle_info p_info;
-							p_info.color_range = { start_color(random()), end_color(random()) };
-							p_info.radius_range = { start_radius(random()), end_radius(random()) };
 
-							rynx::vec3f velocity{ random(0.0f, 200.0f), 0, 0 };
-							rynx::math::rotateXY(velocity, random(rynx::math::pi * 2.0f));
+				rynx::components::light_omni fire_light;
+				fire_light.attenuation_quadratic = 1.0f;
+				fire_light.attenuation_linear = 0.0f;
+				fire_light.color = { 1, 1, 1, 10.01f };
+				fire_light.ambient = 0.05f;
+				
+				commands.attach(id, burning(), fire_light);
 
-							ecs.create(
-								p_info,
-								pos,
-								rynx::components::radius(p_info.radius_range.begin),
-								rynx::components::motion(velocity, random(-1.0f, +1.0f)),
-								rynx::components::lifetime(random(1.0f, 2.0f)),
-								rynx::components::color(p_info.color_range.begin),
-								rynx::components::dampening{ 0.9f, 1.0f },
-								rynx::components::translucent(),
-								rynx::matrix4()
-							);
-						}
 
-						// lights up for explosion.
-						rynx::components::light_omni explosion_light;
-						explosion_light.ambient = 0.1f;
-						explosion_light.color = { 1.0f, 1.0f, 1.0f, 20.f };
-						explosion_light.attenuation_linear = 1.0f;
-						explosion_light.attenuation_quadratic = 0.05f;
-						ecs.create(
-							rynx::components::lifetime(random(1.0f, 3.0f)),
-							explosion_light,
+				// explosion particles
+				if (m_visuals) {
+					rynx::components::position pos = ecs[id].get<const rynx::components::position>();
+
+					// also play some explosy sound or something. why not.
+					audio.play_sound(sounds.get("rocket_death"), pos.value);
+
+					range<rynx::floats4> start_color{ rynx::floats4{0.5f, 0.3f, 0.0f, 0.3f}, rynx::floats4{0.6f, 0.4f, 0.0f, 0.3f} };
+					range<rynx::floats4> end_color{ rynx::floats4{1.0f, 0.3f, 0.0f, 0.0f}, rynx::floats4{1.0f, 0.6f, 0.1f, 0.0f} };
+					range<float> start_radius{ 2.0f, 3.5f };
+					range<float> end_radius{ 0.0f, 0.1f };
+
+					for (int i = 0; i < 1000; ++i) {
+						rynx::components::particle_info p_info;
+						p_info.color_range = { start_color(random()), end_color(random()) };
+						p_info.radius_range = { start_radius(random()), end_radius(random()) };
+
+						rynx::vec3f velocity{ random(0.0f, 200.0f), 0, 0 };
+						rynx::math::rotateXY(velocity, random(rynx::math::pi * 2.0f));
+
+						commands.create(
+							launch_particle(p_info, pos.value, velocity, world_gravity, 0.9f, clock.time, random(1.0f, 2.0f)),
 							pos,
-							rynx::components::radius(20.0f)
+							rynx::components::radius(p_info.radius_range.begin),
+							rynx::components::color(p_info.color_range.begin),
+							rynx::components::translucent(),
+							rynx::components::mesh(m_particle_mesh),
+							rynx::matrix4()
 						);
 					}
+
+					// lights up for explosion.
+					rynx::components::light_omni explosion_light;
+					explosion_light.ambient = 0.1f;
+					explosion_light.color = { 1.0f, 1.0f, 1.0f, 20.f };
+					explosion_light.attenuation_linear = 1.0f;
+					explosion_light.attenuation_quadratic = 0.05f;
+					commands.create(
+						rynx::components::lifetime(random(1.0f, 3.0f)),
+						explosion_light,
+						pos,
+						rynx::components::radius(20.0f)
+					);
 				}
+			}
+
+			if (m_visuals) {
+				for (auto id : m_burning_debris.ids(ecs)) {
+					const auto& pos = ecs[id].get<const rynx::components::position>();
+					auto level = m_debris_lod.classify(view, pos.value, 0.0f);
+					if (!m_debris_lod.due(level, id.value, clock.frame))
+						continue;
 
-				auto positions = ecs.query().in<burning>().notIn<health>().gather<rynx::components::position>();
-				for (const auto& pos_tuple : positions) {
-					const auto& pos = std::get<0>(pos_tuple);
 					for (int i = 0; i < 2; ++i) {
 						range<rynx::floats4> start_color{ rynx::floats4{0.5f, 0.3f, 0.0f, 0.3f}, rynx::floats4{0.6f, 0.4f, 0.0f, 0.3f} };
 						range<rynx::floats4> end_color{ rynx::floats4{1.0f, 0.3f, 0.0f, 0.0f}, rynx::floats4{1.0f, 0.6f, 0.1f, 0.0f} };
@@ -310,27 +487,27 @@ int main(int argc, char** argv) {
 						float upness = (velocity.dot({ 0,1,0 }) / velocity.length());
 						upness = upness * upness * upness * upness;
 
-						ecs.create(
-							p_info,
+						commands.create(
+							launch_particle(p_info, pos.value, velocity, { 0, 100.0f * upness, 0 }, 0.6f, clock.time, random(0.6f, 1.2f)),
 							pos,
 							rynx::components::radius(p_info.radius_range.begin),
-							rynx::components::motion(velocity, random(-1.0f, +1.0f)),
-							rynx::components::lifetime(random(0.6f, 1.2f)),
 							rynx::components::color(p_info.color_range.begin),
-							rynx::components::dampening{ 0.6f, 1.0f },
 							rynx::components::translucent(),
-							rynx::components::ignore_gravity(),
-							fire_lift{ 100.0f * upness },
+							rynx::components::mesh(m_particle_mesh),
 							rynx::matrix4()
 						);
 					}
 				}
 
-				auto entity_data = ecs.query().gather<rynx::components::position, health>();
+				// frame temporaries come from the worker's frame arena, creating entities while iterating is not allowed.
+				game::frame_vector<std::pair<rynx::components::position, health>> entity_data;
+				ecs.query().for_each([&entity_data](const rynx::components::position& pos, const health& hp) { entity_data.emplace_back(pos, hp); });
+
+				for (const auto& [pos, hp] : entity_data) {
+					// parts destroyed this frame still have their health until the commands are played back.
+					if (hp.current <= 0.0f)
+						continue;
 
-				for (const auto& data_line : entity_data) {
-					auto pos = std::get<0>(data_line);
-					auto hp = std::get<1>(data_line);
 
 					int num_fire_particles = static_cast<int>(5.0f * random() * (1.0f - hp.current / hp.max));
 					for (int i = 0; i < num_fire_particles; ++i) {
@@ -350,297 +527,450 @@ int main(int argc, char** argv) {
 						float upness = (velocity.dot({ 0,1,0 }) / velocity.length());
 						upness = upness * upness * upness * upness;
 
-						ecs.create(
-							p_info,
+						commands.create(
+							launch_particle(p_info, pos.value, velocity, { 0, 100.0f * upness, 0 }, 0.6f, clock.time, random(0.6f, 1.2f)),
 							pos,
 							rynx::components::radius(p_info.radius_range.begin),
-							rynx::components::motion(velocity, random(-1.0f, +1.0f)),
-							rynx::components::lifetime(random(0.6f, 1.2f)),
 							rynx::components::color(p_info.color_range.begin),
-							rynx::components::dampening{ 0.6f, 1.0f },
 							rynx::components::translucent(),
-							rynx::components::ignore_gravity(),
-							fire_lift{100.0f * upness},
+							rynx::components::mesh(m_particle_mesh),
 							rynx::matrix4()
 						);
 					}
 				}
+			}
 
-				ecs.query().for_each([](rynx::components::motion& m, fire_lift lift) { m.acceleration += {0, lift.v, 0}; });
-
-				// also we need to detach joints connecting to the dead rocket parts.
-				// and create new physics parts for the joints to connect to.
-
-				auto contains = [](const auto& vec, rynx::ecs::id id) { bool answer = false; for (auto&& bleb : vec) { answer |= (bleb == id); } return answer; };
-				auto joints_a = ecs.query().ids_if([&contains, &ids](const rynx::components::phys::joint& j) { return contains(ids, j.id_a); });
-				auto joints_b = ecs.query().ids_if([&contains, &ids](const rynx::components::phys::joint& j) { return contains(ids, j.id_b); });
-
-				for (auto id : joints_a) {
-					auto target_id = ecs[id].get<rynx::components::phys::joint>().id_a;
-					rynx::components::position pos = ecs[target_id].get<const rynx::components::position>();
-					rynx::components::motion m = ecs[target_id].get<const rynx::components::motion>();
-					rynx::components::collisions col = ecs[target_id].get<const rynx::components::collisions>();
-					auto dummy_id = ecs.create(
-						pos,
-						m,
-						col,
-						rynx::components::radius(1.0f),
-						rynx::components::physical_body().mass(10.0f).moment_of_inertia(10.0f).elasticity(0.0f).friction(1.0f),
-						rynx::components::color{ {1, 1, 1, 0} },
-						rynx::components::dampening{ 0.5f, 0.5f },
-						rynx::components::translucent(),
-						rynx::matrix4()
-					);
-
+			// also we need to detach joints connecting to the dead rocket parts.
+			// and create new physics parts for the joints to connect to.
+			auto joints_a = ecs.query().ids_if([&contains, &ids](const rynx::components::phys::joint& j) { return contains(ids, j.id_a); });
+			auto joints_b = ecs.query().ids_if([&contains, &ids](const rynx::components::phys::joint& j) { return contains(ids, j.id_b); });
+
+			// the dead part may have been asleep, waking it gives it a motion to copy and a dynamic category.
+			auto create_dummy_body = [islands = m_islands](rynx::ecs& ecs, rynx::ecs::id target_id) {
+				islands->wake(ecs, target_id);
+				rynx::components::position pos = ecs[target_id].get<const rynx::components::position>();
+				rynx::components::motion m = ecs[target_id].get<const rynx::components::motion>();
+				rynx::components::collisions col = ecs[target_id].get<const rynx::components::collisions>();
+				return ecs.create(
+					pos,
+					m,
+					col,
+					rynx::components::radius(1.0f),
+					rynx::components::physical_body().mass(10.0f).moment_of_inertia(10.0f).elasticity(0.0f).friction(1.0f),
+					rynx::components::color{ {1, 1, 1, 0} },
+					rynx::components::dampening{ 0.5f, 0.5f },
+					rynx::components::translucent(),
+					rynx::matrix4()
+				);
+			};
+
+			for (auto id : joints_a) {
+				commands.then([id, create_dummy_body](rynx::ecs& ecs) {
+					auto dummy_id = create_dummy_body(ecs, ecs[id].get<rynx::components::phys::joint>().id_a);
 					ecs[id].get<rynx::components::phys::joint>().id_a = dummy_id;
 					ecs[id].get<rynx::components::phys::joint>().point_a = { 0, 0, 0 };
-				}
-
-				for (auto id : joints_b) {
-					auto target_id = ecs[id].get<rynx::components::phys::joint>().id_b;
-					rynx::components::position pos = ecs[target_id].get<const rynx::components::position>();
-					rynx::components::motion m = ecs[target_id].get<const rynx::components::motion>();
-					rynx::components::collisions col = ecs[target_id].get<const rynx::components::collisions>();
-					auto dummy_id = ecs.create(
-						pos,
-						m,
-						col,
-						rynx::components::radius(1.0f),
-						rynx::components::physical_body().mass(10.0f).moment_of_inertia(10.0f).elasticity(0.0f).friction(1.0f),
-						rynx::components::color{ {1, 1, 1, 0} },
-						rynx::components::dampening{ 0.5f, 0.5f },
-						rynx::components::translucent(),
-						rynx::matrix4()
-					);
+				});
+			}
 
+			for (auto id : joints_b) {
+				commands.then([id, create_dummy_body](rynx::ecs& ecs) {
+					auto dummy_id = create_dummy_body(ecs, ecs[id].get<rynx::components::phys::joint>().id_b);
 					ecs[id].get<rynx::components::phys::joint>().id_b = dummy_id;
 					ecs[id].get<rynx::components::phys::joint>().point_b = { 0, 0, 0 };
+				});
+			}
+		});
+
+		// update explosion lights intensity
+		context.add_task("explosion lights", [this](rynx::ecs::view<const rynx::components::lifetime, rynx::components::light_omni> ecs) {
+			auto timing = m_timeline.record(m_explosion_lights_node);
+			ecs.query().for_each([](rynx::components::lifetime lt, rynx::components::light_omni& light) {
+				light.color.w = 20.0f * lt.linear_inv();
+			});
+		});
+	}
+};
+
+class player_controls : public rynx::application::logic::iruleset {
+	rynx::math::rand64 random;
+	rynx::graphics::mesh* m_mesh = nullptr;
+	game::ecs_commands& m_commands;
+	bool m_visuals = true;
+	game::task_timeline& m_timeline;
+	game::task_timeline::node m_input_node;
+public:
+	// without visuals no sounds are played and no engine fumes are spawned, engines still push the ship.
+	player_controls(rynx::graphics::mesh* mesh, game::ecs_commands& commands, game::task_timeline& timeline, bool visuals)
+		: m_mesh(mesh), m_commands(commands), m_visuals(visuals), m_timeline(timeline), m_input_node(timeline.declare("player input", this)) {}
+	
+	virtual ~player_controls() {}
+	
+	virtual void onFrameProcess(rynx::scheduler::context& context, float) override {
+		context.add_task("player input", [this](
+			rynx::scheduler::task& context,
+			const game::frame_clock& clock,
+			const ship_controls& controls,
+			rynx::sound::audio_system& sound,
+			sound_mapper& sound_map,
+			rynx::ecs::view<
+				const player_controlled,
+				const rynx::components::position,
+				rynx::components::motion,
+				ship_engine,
+				ship_engine_sound,
+				rynx::components::light_omni> ecs)
+		{
+			auto timing = m_timeline.record(m_input_node);
+
+			struct engine_fumes {
+				range<rynx::vec3f> direction;
+				range<rynx::vec3f> position;
+				range<float> radius;
+				range<rynx::floats4> color;
+				range<float> lifetime;
+				range<int> number;
+			};
+			
+			uint32_t controls_down = controls.down;
+
+			// dense pass over all engines. only touches engine data and the engine's own light.
+			ecs.query().for_each([controls_down, dt = clock.dt](ship_engine& engine, rynx::components::light_omni& engine_light) {
+				bool engine_is_activated = (engine.activated_by & controls_down) != 0;
+				bool engine_is_active = engine.activity > 0.95f;
+				engine.thrust = engine.power * 1000.00f * float(engine_is_activated && engine_is_active);
+				engine.state &= ~uint32_t(ship_engine::activated | ship_engine::ignited);
+
+				if (engine_is_activated) {
+					engine.state |= ship_engine::activated;
+					engine.activity += (1.0f - engine.activity) * dt * engine.startup_time_multiplier;
+					bool mega_boom = !engine_is_active && engine.activity > 0.95f && !(engine.state & ship_engine::roaring);
+					if (mega_boom) {
+						engine.state |= ship_engine::roaring | ship_engine::ignited;
+						if (engine.state & ship_engine::has_activation_sound) {
+							engine.activity = 3.5f;
+						}
+					}
+				}
+				else {
+					engine.activity += (0.0f - engine.activity) * dt * 2;
 				}
 
-				// update explosion lights intensity
-				{
-					ecs.query().for_each([](rynx::components::lifetime lt, rynx::components::light_omni& light) {
-						light.color.w = 20.0f * lt.linear_inv();
-					});
+				engine.phase += engine.activity * 0.01f;
+				if (engine.phase > 2 * rynx::math::pi) {
+					engine.phase -= 2 * rynx::math::pi;
 				}
 
+				engine_light.color.w = 20.0f * engine.activity * engine.activity * engine.power;
+				engine_light.ambient = std::clamp(engine.activity * engine.activity * engine.power, 0.0f, 1.0f);
+				if (engine.activity < 0.25f)
+					engine.state &= ~uint32_t(ship_engine::roaring);
 			});
-		}
-	};
 
-	class player_controls : public rynx::application::logic::iruleset {
-		rynx::math::rand64 random;
-		rynx::graphics::mesh* m_mesh = nullptr;
-	public:
-		player_controls(rynx::graphics::mesh* mesh) :m_mesh(mesh) {}
-		
-		virtual ~player_controls() {}
-		
-		virtual void onFrameProcess(rynx::scheduler::context& context, float dt) override {
-			context.add_task("player input", [this, dt](
-				rynx::scheduler::task& context,
-				const rynx::mapped_input& input,
-				rynx::sound::audio_system& sound,
-				sound_mapper& sound_map,
-				rynx::ecs::view<
-					const player_controlled,
-					const rynx::components::position,
-					rynx::components::motion,
-					std::vector<ship_engine_state>,
-					rynx::components::light_omni> ecs)
-			{
-				struct engine_fumes {
-					range<rynx::vec3f> direction;
-					range<rynx::vec3f> position;
-					range<float> radius;
-					range<rynx::floats4> color;
-					range<float> lifetime;
-					range<int> number;
-				};
-				
-				std::vector<engine_fumes> fumes;
-				ecs.query().for_each([&](rynx::components::motion& motion, rynx::components::position position, std::vector<ship_engine_state>& engines) {
-					for (auto&& engine : engines) {
-						int32_t engine_is_activated = 0;
-						for (auto key : engine.activated_by_keys) {
-							engine_is_activated |= input.isKeyDown(key);
-						}
+			// sounds, fumes and thrust for engines that are running.
+			game::frame_vector<engine_fumes> fumes;
+			ecs.query().for_each([&](const ship_engine& engine, ship_engine_sound& engine_sound) {
+				bool engine_is_activated = (engine.state & ship_engine::activated) != 0;
+				if (!engine_is_activated && engine.activity < 0.01f)
+					return;
 
-						float accelerate_amount = engine.power * 1000.00f * engine_is_activated * (engine.activity > 0.95f);
+				auto host = ecs[engine.host];
+				const auto& position = host.get<const rynx::components::position>();
+				rynx::vec3f forward(std::cos(position.angle + engine.direction), std::sin(position.angle + engine.direction), 0);
+				host.get<rynx::components::motion>().acceleration += forward * engine.thrust;
+				if (!m_visuals)
+					return;
 
-						rynx::vec3f forward(std::cos(position.angle + engine.direction), std::sin(position.angle + engine.direction), 0);
-						motion.acceleration += forward * accelerate_amount;
+				bool is_roaring = (engine.state & ship_engine::roaring) != 0;
+				float main_engine_max_per_sound = 0.3f;
+				float engine_sound_loudness = engine.activity < 1.0f ? engine.activity * engine.activity * engine.activity * engine.activity * engine.activity * main_engine_max_per_sound : main_engine_max_per_sound;
+				engine_sound.conf.set_loudness(engine_sound_loudness);
+				if (is_roaring) {
+					engine_sound.conf.set_pitch_shift(0.6f * std::sin(engine.phase));
+				}
 
-						engine_fumes f;
-						f.radius = { 0.5f, 1.2f };
-						f.color = { rynx::floats4(0.7f, 0.7f, 0.1f, 0.7f), rynx::floats4(1.0f, 1.0f, 0.5f, 0.9f) };
-						f.number = { 1, 5 };
-						f.lifetime = { 0.1f, 0.2f };
+				bool mega_boom = (engine.state & ship_engine::ignited) && engine_sound.activation_sound >= 0;
+				if (mega_boom) {
+					auto conf = sound.play_sound(sound_map.get(engine_sound.activation_sound), position.value, rynx::vec3f(), 0.5f);
+					conf.set_pitch_shift(-0.25f);
+				}
 
-						bool engine_is_active = engine.activity > 0.95f;
-						float main_engine_max_per_sound = 0.3f;
-						float engine_sound_loudness_old = engine.activity < 1.0f ? engine.activity * engine.activity * engine.activity * engine.activity * engine.activity * main_engine_max_per_sound : main_engine_max_per_sound;
-						engine.sound_conf.set_loudness(engine_sound_loudness_old);
-						if (engine.is_roaring) {
-							engine.sound_conf.set_pitch_shift(0.6f * std::sin(engine.phase));
-						}
+				if (engine_is_activated && is_roaring) {
+					engine_fumes f;
+					f.color = { rynx::floats4(0.7f, 0.7f, 0.1f, 0.7f), rynx::floats4(1.0f, 1.0f, 0.5f, 0.9f) };
+					f.position = { position.value - forward * 2.0f, position.value - forward * 3.0f };
+					f.direction = { rynx::math::rotatedXY(-forward, +0.6f), rynx::math::rotatedXY(-forward, -0.6f) };
+
+					int number_min = static_cast<int>(1 + engine.power * 5);
+					int number_max = static_cast<int>(2 + engine.power * 10);
+					f.number = { number_min, number_max };
+					if (mega_boom) {
+						f.direction = { rynx::math::rotatedXY(-forward, 1.2f), rynx::math::rotatedXY(-forward, -1.2f) };
+						f.number = { 300 , 700 };
+					}
 
-						if (engine_is_activated) {
-							engine.activity += (1.0f - engine.activity) * dt * engine.startup_time_multiplier;
-							bool mega_boom = !engine_is_active && engine.activity > 0.95f && !engine.is_roaring;
-							if (mega_boom) {
-								engine.is_roaring = true;
-								if (!engine.activation_sound.empty()) {
-									auto conf = sound.play_sound(sound_map.get(engine.activation_sound), position.value, rynx::vec3f(), 0.5f);
-									conf.set_pitch_shift(-0.25f);
-									engine.activity = 3.5f;
-								}
-							}
-
-							if (engine.is_roaring) {
-								f.position = { position.value - forward * 2.0f, position.value - forward * 3.0f };
-								f.direction = { rynx::math::rotatedXY(-forward, +0.6f), rynx::math::rotatedXY(-forward, -0.6f) };
-
-								int number_min = static_cast<int>(1 + engine.power * 5);
-								int number_max = static_cast<int>(2 + engine.power * 10);
-								f.number = { number_min, number_max };
-								if (mega_boom && !engine.activation_sound.empty()) {
-									f.direction = { rynx::math::rotatedXY(-forward, 1.2f), rynx::math::rotatedXY(-forward, -1.2f) };
-									f.number = { 300 , 700 };
-								}
-
-								f.radius = { 0.6f + 0.4f * engine.power, 1.3f + 0.7f * engine.power };
-								f.lifetime = { 0.2f, 0.5f };
-								fumes.emplace_back(f);
-							}
-
-							if (engine.sound_conf.completion_rate() > 0.66f) {
-								if (engine.is_roaring) {
-									engine.sound_conf = sound.play_sound(sound_map.get(engine.sound_event_name), position.value);
-									engine.sound_conf.set_loudness(engine.activity < 1.0f ? engine.activity * engine.activity * engine.activity * engine.activity * engine.activity * main_engine_max_per_sound : main_engine_max_per_sound);
-									engine.sound_conf.set_pitch_shift(0.1f * std::sin(engine.phase));
-								}
-								else {
-									engine.sound_conf = sound.play_sound(sound_map.get(engine.sound_event_name), position.value);
-									engine.sound_conf.set_loudness(engine_sound_loudness_old);
-									engine.sound_conf.set_pitch_shift(1.0f - 0.5f * std::min(engine.activity, 1.0f));
-								}
-							}
-						}
-						else {
-							engine.activity += (0.0f - engine.activity) * dt * 2;
-
-							if (engine.sound_conf.completion_rate() > 0.66f && engine.activity > 0.1f) {
-								if (engine.is_roaring) {
-									engine.sound_conf = sound.play_sound(sound_map.get(engine.sound_event_name), position.value);
-									engine.sound_conf.set_loudness(engine_sound_loudness_old);
-									engine.sound_conf.set_pitch_shift(0.4f * std::sin(engine.phase));
-								}
-								else {
-									engine.sound_conf = sound.play_sound(sound_map.get(engine.sound_event_name), position.value);
-									engine.sound_conf.set_loudness(engine_sound_loudness_old);
-									engine.sound_conf.set_pitch_shift(1.0f - 0.5f * std::min(engine.activity, 1.0f));
-								}
-							}
-						}
+					f.radius = { 0.6f + 0.4f * engine.power, 1.3f + 0.7f * engine.power };
+					f.lifetime = { 0.2f, 0.5f };
+					fumes.emplace_back(f);
+				}
 
-						engine.phase += engine.activity * 0.01f;
-						if (engine.phase > 2 * rynx::math::pi) {
-							engine.phase -= 2 * rynx::math::pi;
-						}
+				if (engine_sound.conf.completion_rate() > 0.66f && (engine_is_activated || engine.activity > 0.1f)) {
+					engine_sound.conf = sound.play_sound(sound_map.get(engine_sound.operating_sound), position.value);
+					engine_sound.conf.set_loudness(engine_sound_loudness);
+					if (is_roaring) {
+						engine_sound.conf.set_pitch_shift((engine_is_activated ? 0.1f : 0.4f) * std::sin(engine.phase));
+					}
+					else {
+						engine_sound.conf.set_pitch_shift(1.0f - 0.5f * std::min(engine.activity, 1.0f));
+					}
+				}
+			});
 
-						auto& engine_light = ecs[engine.light_id].get<rynx::components::light_omni>();
-						engine_light.color.w = 20.0f * engine.activity * engine.activity * engine.power;
-						engine_light.ambient = std::clamp(engine.activity * engine.activity * engine.power, 0.0f, 1.0f);
-						if (engine.activity < 0.25f)
-							engine.is_roaring = false;
+			if (!fumes.empty()) {
+				context.make_task("create engine fumes", [this, fumes = std::move(fumes), time = clock.time]() {
+					game::ecs_commands::recorder commands(m_commands, command_channel::engine_fumes);
+					for (auto&& fume : fumes) {
+						int num_fumes = fume.number(random());
+						for (int i = 0; i < num_fumes; ++i) {
+							rynx::components::particle_info p_info;
+							p_info.color_range.begin = fume.color(random());
+							p_info.color_range.end = p_info.color_range.begin;
+							p_info.color_range.end.w = 0.0f;
+							p_info.color_range.end.x *= 0.5f;
+							p_info.color_range.end.y *= 0.5f;
+							p_info.radius_range.begin = fume.radius(random());
+							p_info.radius_range.end = p_info.radius_range.begin * 2.0f;
+
+							float quadratic_favor_middle = random(-1.0f, +1.0f) * random(-1.0f, +1.0f);
+							float lifetime_modifier = 1.0f - std::abs(quadratic_favor_middle);
+							lifetime_modifier *= lifetime_modifier;
+
+							quadratic_favor_middle = quadratic_favor_middle * 0.5f + 0.5f;
+
+							rynx::vec3f origin = fume.position(random());
+							rynx::vec3f velocity = fume.direction(quadratic_favor_middle).normalize() * 120 * random(0.6f, 1.8f) * lifetime_modifier;
+							commands.create(
+								launch_particle(p_info, origin, velocity, world_gravity, 0.0f, time, fume.lifetime(random()) * lifetime_modifier),
+								rynx::components::position(origin),
+								rynx::components::radius(p_info.radius_range.begin),
+								rynx::components::color(p_info.color_range.begin),
+								rynx::components::translucent(),
+								rynx::components::mesh(m_mesh),
+								rynx::matrix4()
+							);
+						}
 					}
 				});
+			}
+		});
+	}
+};
 
-				if (!fumes.empty()) {
-					context.make_task("create engine fumes", [this, fumes = std::move(fumes)](rynx::ecs& ecs) {
-						for (auto&& fume : fumes) {
-							int num_fumes = fume.number(random());
-							for (int i = 0; i < num_fumes; ++i) {
-								rynx::components::particle_info p_info;
-								p_info.color_range.begin = fume.color(random());
-								p_info.color_range.end = p_info.color_range.begin;
-								p_info.color_range.end.w = 0.0f;
-								p_info.color_range.end.x *= 0.5f;
-								p_info.color_range.end.y *= 0.5f;
-								p_info.radius_range.begin = fume.radius(random());
-								p_info.radius_range.end = p_info.radius_range.begin * 2.0f;
-
-								float quadratic_favor_middle = random(-1.0f, +1.0f) * random(-1.0f, +1.0f);
-								float lifetime_modifier = 1.0f - std::abs(quadratic_favor_middle);
-								lifetime_modifier *= lifetime_modifier;
-
-								quadratic_favor_middle = quadratic_favor_middle * 0.5f + 0.5f;
-
-								auto particle_id = ecs.create(
-									p_info,
-									rynx::components::position(fume.position(random())),
-									rynx::components::radius(p_info.radius_range.begin),
-									rynx::components::motion(fume.direction(quadratic_favor_middle).normalize() * 120 * random(0.6f, 1.8f) * lifetime_modifier, random(-1.0f, +1.0f)),
-									rynx::components::lifetime(fume.lifetime(random()) * lifetime_modifier),
-									rynx::components::color(p_info.color_range.begin),
-									rynx::components::dampening{ 0.0f, 0.0f },
-									rynx::components::translucent(),
-									rynx::components::mesh(m_mesh),
-									rynx::matrix4()
-								);
-							}
-						}
-					});
-				}
-			});
+// keeps position_relative entities (engines and their lights) attached to their hosts.
+// dependents are grouped by host, and only hosts that moved since the previous update are visited.
+class relative_position_updater {
+public:
+	relative_position_updater(game::component_versions& versions) : m_relatives(versions) {}
+
+	void update(rynx::ecs& ecs) {
+		const auto& ids = m_relatives.ids(ecs);
+		if (m_relatives.version() != m_groups_version) {
+			rebuild_groups(ecs, ids);
+			m_groups_version = m_relatives.version();
 		}
+
+		m_host_moves.for_each_changed(ecs, m_hosts, [this, &ecs](size_t index, const rynx::components::position& host_pos) {
+			for (auto id : m_dependents[index]) {
+				auto entity = ecs[id];
+				const auto& relative_pos = entity.get<const rynx::components::position_relative>();
+				entity.get<rynx::components::position>().value = host_pos.value + rynx::math::rotatedXY(relative_pos.relative_pos, host_pos.angle);
+			}
+		});
+	}
+
+private:
+	void rebuild_groups(rynx::ecs& ecs, const std::vector<rynx::ecs::id>& ids) {
+		m_hosts.clear();
+		m_dependents.clear();
+		m_host_moves.reset();
+
+		rynx::unordered_map<rynx::ecs::entity_id_t, size_t> host_index;
+		for (auto id : ids) {
+			auto host = ecs[id].get<const rynx::components::position_relative>().host;
+			auto it = host_index.find(host);
+			if (it == host_index.end()) {
+				it = host_index.emplace(host, m_hosts.size()).first;
+				m_hosts.emplace_back(host);
+				m_dependents.emplace_back();
+			}
+			m_dependents[it->second].emplace_back(id);
+		}
+	}
+
+	game::cached_query<game::types<rynx::components::position_relative>> m_relatives;
+	game::change_filter<rynx::components::position> m_host_moves;
+	std::vector<rynx::ecs::id> m_hosts;
+	std::vector<std::vector<rynx::ecs::id>> m_dependents;
+	uint64_t m_groups_version = 0;
+};
+
+// one independent simulation: its own ecs, collision detection, rulesets and mission state.
+// the game runs one of these, batch runs host many of them on a shared scheduler and job pool.
+class rocket_world {
+public:
+	struct config {
+		// headless worlds play no sounds, spawn no purely visual entities and skip render side rulesets.
+		bool headless = false;
+		rynx::graphics::mesh* part_mesh = nullptr;
+		rynx::graphics::mesh* fume_mesh = nullptr;
+		std::shared_ptr<rynx::camera> camera;
+		std::function<rynx::graphics::mesh*(const rynx::polygon&)> make_terrain_mesh;
+		game::joint_solver_config joints;
+		game::sleep_config sleep;
+		game::continuous_collision_config continuous_collisions;
+		game::lod_policy particle_lod;
+		game::lod_policy debris_lod;
+		std::vector<game::mesh_lod_chain> mesh_lods; // meshes of these chains are swapped by size on screen.
+	};
+
+	struct level_params {
+		float engine_power = 1.0f; // multiplies the power of every engine on the ship.
+		float engine_startup_time = 1.0f; // multiplies the startup time multiplier of every engine.
+		uint64_t terrain_seed = 0; // zero continues from the previous level's random state.
 	};
-	
 
-	// setup game logic
+	rocket_world(rynx::scheduler::task_scheduler& scheduler, game::job_pool& pool, rynx::sound::audio_system& audio, sound_mapper& sounds, config conf)
+		: simulation(scheduler)
+		, ecs(simulation.m_ecs)
+		, collision_detection(std::make_unique<rynx::collision_detection>())
+		, commands(versions)
+		, relative_positions(versions)
+		, dead_entities(versions)
+		, mesh_lods(versions)
+		, m_pool(pool)
+		, m_config(std::move(conf))
+		, m_sounds(sounds)
 	{
+		category_dynamic = collision_detection->add_category();
+		category_static = collision_detection->add_category();
+		category_projectiles = collision_detection->add_category();
+		category_sleeping = collision_detection->add_category();
+
+		collision_detection->enable_collisions_between(category_dynamic, category_dynamic); // enable dynamic <-> dynamic collisions
+		collision_detection->enable_collisions_between(category_dynamic, category_static.ignore_collisions()); // enable dynamic <-> static collisions
+
+		collision_detection->enable_collisions_between(category_projectiles, category_static.ignore_collisions()); // projectile <-> static
+		collision_detection->enable_collisions_between(category_projectiles, category_dynamic); // projectile <-> dynamic
+
+		// resting islands leave the dynamic category. only awake things can hit them, which wakes them up again.
+		// until then they are like terrain, the physics must not touch the motion they don't have.
+		collision_detection->enable_collisions_between(category_dynamic, category_sleeping.ignore_collisions());
+		collision_detection->enable_collisions_between(category_projectiles, category_sleeping.ignore_collisions());
+		islands = std::make_unique<game::island_sleeping>(versions, *collision_detection, category_dynamic.value, category_sleeping.value, m_config.sleep);
+
+		for (const auto& chain : m_config.mesh_lods)
+			mesh_lods.add_chain(chain);
+
+		simulation.set_resource(collision_detection.get());
+		simulation.set_resource(&audio);
+		simulation.set_resource(&sounds);
+		simulation.set_resource(&mission);
+		simulation.set_resource(&clock);
+		simulation.set_resource(&controls);
+		simulation.set_resource(&contacts);
+		simulation.set_resource(&view);
+
 		// Todo: if we created the rulesets through base simulation, and returned proxy objects that on destructor move themselves into the simulation rules..
 		//       we could remove like 50% of this setup code?
 		auto ruleset_collisionDetection = std::make_unique<rynx::ruleset::physics_2d>();
 		auto ruleset_particle_update = std::make_unique<rynx::ruleset::particle_system>();
-		auto ruleset_frustum_culling = std::make_unique<rynx::ruleset::frustum_culling>(camera);
-
-		auto ruleset_motion_updates = std::make_unique<rynx::ruleset::motion_updates>(rynx::vec3<float>(0, -160.8f, 0));
-		auto ruleset_physical_springs = std::make_unique<rynx::ruleset::physics::springs>();
-		auto ruleset_player_controls = std::make_unique<player_controls>(meshes->get("circle_empty"));
-		auto ruleset_rocket_destruction = std::make_unique<rocket_component_destruction>();
-
-		ruleset_rocket_destruction->required_for(*ruleset_motion_updates);
-		ruleset_physical_springs->depends_on(*ruleset_motion_updates);
-		ruleset_collisionDetection->depends_on(*ruleset_motion_updates);
-		ruleset_frustum_culling->depends_on(*ruleset_motion_updates);
-		ruleset_player_controls->depends_on(*ruleset_motion_updates);
-		ruleset_player_controls->required_for(*ruleset_collisionDetection);
-		
-		base_simulation.add_rule_set(std::move(ruleset_rocket_destruction));
-		base_simulation.add_rule_set(std::move(ruleset_motion_updates));
-		base_simulation.add_rule_set(std::move(ruleset_physical_springs));
-
-		base_simulation.add_rule_set(std::move(ruleset_collisionDetection));
-		base_simulation.add_rule_set(std::move(ruleset_particle_update));
-		base_simulation.add_rule_set(std::move(ruleset_frustum_culling));
-		base_simulation.add_rule_set(std::move(ruleset_player_controls));
+
+		auto ruleset_motion_updates = std::make_unique<rynx::ruleset::motion_updates>(world_gravity);
+		auto ruleset_contact_detection = std::make_unique<game::contact_detection>(pool, timeline, terrain);
+		ruleset_contact_detection->enable_contacts_between(category_dynamic.value, category_dynamic.value);
+		ruleset_contact_detection->enable_contacts_between(category_projectiles.value, category_dynamic.value);
+		ruleset_contact_detection->enable_contacts_between(category_dynamic.value, category_sleeping.value);
+		ruleset_contact_detection->enable_contacts_between(category_projectiles.value, category_sleeping.value);
+		ruleset_contact_detection->enable_terrain_contacts(category_dynamic.value);
+		ruleset_contact_detection->enable_terrain_contacts(category_projectiles.value);
+		auto ruleset_ballistic_particles = std::make_unique<game::ballistic_particles>(pool, commands, command_channel::particle_expiry, versions, timeline, m_config.particle_lod);
+		auto ruleset_joint_solver = std::make_unique<game::joint_solver>(pool, versions, timeline, m_config.joints);
+		auto ruleset_continuous_collisions = std::make_unique<game::continuous_collisions>(pool, timeline, terrain, m_config.continuous_collisions);
+		ruleset_continuous_collisions->enable_category(category_dynamic.value);
+		ruleset_continuous_collisions->enable_category(category_projectiles.value);
+		ruleset_continuous_collisions->enable_obstacle_category(category_sleeping.value);
+		continuous_collisions = ruleset_continuous_collisions.get();
+		auto ruleset_player_controls = std::make_unique<player_controls>(m_config.fume_mesh, commands, timeline, !m_config.headless);
+		auto ruleset_rocket_destruction = std::make_unique<rocket_component_destruction>(pool, commands, versions, timeline, !m_config.headless, m_config.debris_lod, m_config.fume_mesh, *islands);
+
+		// culling only matters for what gets rendered.
+		std::unique_ptr<rynx::ruleset::frustum_culling> ruleset_frustum_culling;
+		if (!m_config.headless)
+			ruleset_frustum_culling = std::make_unique<rynx::ruleset::frustum_culling>(m_config.camera);
+
+		// the instrumented tasks in the task timeline get the same ordering as the rulesets.
+		game::ruleset_graph graph(timeline);
+		graph.order(*ruleset_rocket_destruction, *ruleset_motion_updates);
+		graph.order(*ruleset_motion_updates, *ruleset_joint_solver);
+		graph.order(*ruleset_motion_updates, *ruleset_collisionDetection);
+		graph.order(*ruleset_motion_updates, *ruleset_continuous_collisions);
+		graph.order(*ruleset_continuous_collisions, *ruleset_collisionDetection);
+		graph.order(*ruleset_motion_updates, *ruleset_contact_detection);
+		graph.order(*ruleset_continuous_collisions, *ruleset_contact_detection);
+		graph.order(*ruleset_player_controls, *ruleset_contact_detection);
+		graph.order(*ruleset_contact_detection, *ruleset_collisionDetection);
+		graph.order(*ruleset_motion_updates, *ruleset_player_controls);
+		graph.order(*ruleset_player_controls, *ruleset_collisionDetection);
+		graph.add(*ruleset_ballistic_particles); // only touches its own particles, no ordering needed.
+		if (ruleset_frustum_culling)
+			graph.order(*ruleset_motion_updates, *ruleset_frustum_culling);
+
+		// engine rulesets can't be instrumented from the inside, time each of them as a whole.
+		std::vector<game::ruleset_graph::span_markers> engine_spans;
+		engine_spans.emplace_back(graph.measure(*ruleset_motion_updates, "motion updates"));
+		engine_spans.emplace_back(graph.measure(*ruleset_collisionDetection, "physics 2d"));
+		engine_spans.emplace_back(graph.measure(*ruleset_particle_update, "particle system"));
+		if (ruleset_frustum_culling)
+			engine_spans.emplace_back(graph.measure(*ruleset_frustum_culling, "frustum culling"));
+		graph.declare_timeline_edges();
+
+		simulation.add_rule_set(std::move(ruleset_rocket_destruction));
+		simulation.add_rule_set(std::move(ruleset_motion_updates));
+		simulation.add_rule_set(std::move(ruleset_joint_solver));
+
+		simulation.add_rule_set(std::move(ruleset_continuous_collisions));
+		simulation.add_rule_set(std::move(ruleset_contact_detection));
+		simulation.add_rule_set(std::move(ruleset_collisionDetection));
+		simulation.add_rule_set(std::move(ruleset_particle_update));
+		simulation.add_rule_set(std::move(ruleset_ballistic_particles));
+		simulation.add_rule_set(std::move(ruleset_player_controls));
+		if (ruleset_frustum_culling)
+			simulation.add_rule_set(std::move(ruleset_frustum_culling));
+
+		for (auto& span : engine_spans) {
+			simulation.add_rule_set(std::move(span.begin));
+			simulation.add_rule_set(std::move(span.end));
+		}
 	}
 
-	rynx::smooth<rynx::vec3<float>> cameraPosition(0.0f, 0.0f, 300.0f);
+	rocket_world(const rocket_world&) = delete;
+	rocket_world& operator = (const rocket_world&) = delete;
 
-	rynx::math::rand64 random;
-	
 	// setup simulation initial state
-	auto construct_level = [&]()
-	{
-		static int level = 0;
-		++level;
-		
+	void construct_level() {
+		construct_level(level_params());
+	}
+
+	void construct_level(const level_params& params) {
+		++m_level;
+		if (params.terrain_seed != 0)
+			m_random = rynx::math::rand64(params.terrain_seed);
+
 		ecs.clear();
-		collisionDetection.clear();
-		base_simulation.clear();
+		collision_detection->clear();
+		islands->clear();
+		simulation.clear();
+		versions.touch_all();
+		mission = mission_state();
 
 		std::vector<rynx::ecs::entity_id_t> ship_entities;
 		auto ship_id = ecs.create();
@@ -650,26 +980,24 @@ int main(int argc, char** argv) {
 			rynx::components::motion(),
 			rynx::components::physical_body().mass(100.0f).moment_of_inertia(500.0f).elasticity(0.3f).friction(1.0f),
 			rynx::components::radius(3.0f),
-			rynx::components::collisions{ collisionCategoryDynamic.value },
+			rynx::components::collisions{ category_dynamic.value },
 			rynx::components::color(),
-			rynx::components::mesh{ meshes->get("ball") },
+			rynx::components::mesh{ m_config.part_mesh },
 			rynx::matrix4(),
-			rynx::components::dampening({ 0.10f, 0.0f }),
-			rynx::components::collision_custom_reaction()
+			rynx::components::dampening({ 0.10f, 0.0f })
 		);
-		
+	
 		auto top_part = ecs.create(
 			health(),
 			rynx::components::position({10, 0, 0}),
 			rynx::components::motion(),
 			rynx::components::physical_body().mass(100.0f).moment_of_inertia(500.0f).elasticity(0.3f).friction(1.0f),
 			rynx::components::radius(3.0f),
-			rynx::components::collisions{ collisionCategoryDynamic.value },
+			rynx::components::collisions{ category_dynamic.value },
 			rynx::components::color(),
-			rynx::components::mesh{ meshes->get("ball") },
+			rynx::components::mesh{ m_config.part_mesh },
 			rynx::matrix4(),
-			rynx::components::dampening({ 0.10f, 0.0f }),
-			rynx::components::collision_custom_reaction()
+			rynx::components::dampening({ 0.10f, 0.0f })
 		);
 
 		auto top_part2 = ecs.create(
@@ -678,12 +1006,11 @@ int main(int argc, char** argv) {
 			rynx::components::motion(),
 			rynx::components::physical_body().mass(100.0f).moment_of_inertia(500.0f).elasticity(0.3f).friction(1.0f),
 			rynx::components::radius(3.0f),
-			rynx::components::collisions{ collisionCategoryDynamic.value },
+			rynx::components::collisions{ category_dynamic.value },
 			rynx::components::color(),
-			rynx::components::mesh{ meshes->get("ball") },
+			rynx::components::mesh{ m_config.part_mesh },
 			rynx::matrix4(),
-			rynx::components::dampening({ 0.10f, 0.0f }),
-			rynx::components::collision_custom_reaction()
+			rynx::components::dampening({ 0.10f, 0.0f })
 		);
 
 		auto landing_fin_left = ecs.create(
@@ -692,12 +1019,11 @@ int main(int argc, char** argv) {
 			rynx::components::motion(),
 			rynx::components::physical_body().mass(100.0f).moment_of_inertia(500.0f).elasticity(0.3f).friction(1.0f),
 			rynx::components::radius(3.0f),
-			rynx::components::collisions{ collisionCategoryDynamic.value },
+			rynx::components::collisions{ category_dynamic.value },
 			rynx::components::color(),
-			rynx::components::mesh{ meshes->get("ball") },
+			rynx::components::mesh{ m_config.part_mesh },
 			rynx::matrix4(),
-			rynx::components::dampening({ 0.10f, 0.0f }),
-			rynx::components::collision_custom_reaction()
+			rynx::components::dampening({ 0.10f, 0.0f })
 		);
 
 		auto landing_fin_right = ecs.create(
@@ -706,43 +1032,40 @@ int main(int argc, char** argv) {
 			rynx::components::motion(),
 			rynx::components::physical_body().mass(100.0f).moment_of_inertia(500.0f).elasticity(0.3f).friction(1.0f),
 			rynx::components::radius(3.0f),
-			rynx::components::collisions{ collisionCategoryDynamic.value },
+			rynx::components::collisions{ category_dynamic.value },
 			rynx::components::color(),
-			rynx::components::mesh{ meshes->get("ball") },
+			rynx::components::mesh{ m_config.part_mesh },
 			rynx::matrix4(),
-			rynx::components::dampening({ 0.10f, 0.0f }),
-			rynx::components::collision_custom_reaction()
+			rynx::components::dampening({ 0.10f, 0.0f })
 		);
 
 		auto foo = [&](rynx::ecs::entity_id_t a, rynx::ecs::entity_id_t b, float angle, float length, float offset)
 		{
-			rynx::components::phys::joint ship_to_top;
-			ship_to_top.connect_with_rod().rotation_free();
+			game::rod ship_to_top;
+			ship_to_top.a = a;
+			ship_to_top.b = b;
 			ship_to_top.length = length;
-			ship_to_top.strength = 25.0f;
-			ship_to_top.id_a = a;
-			ship_to_top.id_b = b;
 			ship_to_top.point_a = { 0, offset, 0 };
 			ship_to_top.point_b = { 0, offset, 0 };
 			rynx::math::rotateXY(ship_to_top.point_a, angle);
 			rynx::math::rotateXY(ship_to_top.point_b, angle);
 
-			ecs.create(ship_to_top);
+			game::create_rod(ecs, ship_to_top);
 
 			if (offset > 0.001f) {
 				ship_to_top.point_a *= -1;
 				ship_to_top.point_b *= -1;
-				ecs.create(ship_to_top);
+				game::create_rod(ecs, ship_to_top);
 			}
 
 			if (offset > 1.0f) {
 				ship_to_top.length = rynx::math::sqrt_approx(length * length + 4 * offset * offset);
 				ship_to_top.point_a *= -1;
-				ecs.create(ship_to_top);
+				game::create_rod(ecs, ship_to_top);
 
 				ship_to_top.point_a *= -1;
 				ship_to_top.point_b *= -1;
-				ecs.create(ship_to_top);
+				game::create_rod(ecs, ship_to_top);
 			}
 		};
 
@@ -754,6 +1077,7 @@ int main(int argc, char** argv) {
 		foo(ship_id, landing_fin_right, +rynx::math::pi * 0.25f, rynx::math::sqrt_approx(7 * 7 + 7 * 7), 3);
 		foo(landing_fin_left, landing_fin_right, 0, 14, 0);
 
+		ship_body = ship_id;
 		ship_entities.emplace_back(ship_id);
 		ship_entities.emplace_back(top_part);
 		ship_entities.emplace_back(top_part2);
@@ -779,44 +1103,41 @@ int main(int argc, char** argv) {
 
 		rotate_around(ship_id, rynx::math::pi * 0.5f); // turn rocket upright at start.
 		translate({0.0f, 360.0f, 0});
-		
-		auto moveForwardKey = gameInput.generateAndBindGameKey('W', "MoveForward");
-		auto turnRightKey = gameInput.generateAndBindGameKey('D', "TurnRight");
-		auto turnLeftKey = gameInput.generateAndBindGameKey('A', "TurnLeft");
-		auto moveBackwardKey = gameInput.generateAndBindGameKey('S', "MoveBackward");
+	
+		auto attach_engine_to = [&](rynx::ecs::id dst, uint32_t activated_by, std::string activation_sound, std::string engine_operating_sound, float direction, float startupTimeMultiplier, float engine_power_multiplier) {
+			ship_engine engine;
+			engine.host = dst.value;
+			engine.activated_by = activated_by;
+			engine.direction = direction;
+			engine.power = engine_power_multiplier * params.engine_power;
+			engine.startup_time_multiplier = startupTimeMultiplier * params.engine_startup_time;
+
+			ship_engine_sound engine_sound;
+			engine_sound.operating_sound = m_sounds.event_id(engine_operating_sound);
+			if (!activation_sound.empty()) {
+				engine_sound.activation_sound = m_sounds.event_id(activation_sound);
+				engine.state |= ship_engine::has_activation_sound;
+			}
 
-		auto attach_engine_to = [&](rynx::ecs::id dst, std::vector<rynx::key::logical> activated_by_keys, std::string activation_sound, std::string engine_operating_sound, float direction, float startupTimeMultiplier, float engine_power_multiplier) {
-			auto ship_engine = ecs.create(
+			ecs.create(
+				engine,
+				engine_sound,
 				rynx::components::position(),
 				rynx::components::position_relative{ dst.value, rynx::math::rotatedXY(rynx::vec3f(-5.0f, 0, 0), direction) },
 				rynx::components::light_omni({ rynx::floats4(1.0f, 1.0f, 1.0f, 0.0f), 0.0f })
 			);
-
-			ship_engine_state engine;
-			engine.activated_by_keys = activated_by_keys;
-			engine.activation_sound = activation_sound;
-			engine.direction = direction;
-			engine.light_id = ship_engine;
-			engine.power = engine_power_multiplier;
-			engine.startup_time_multiplier = startupTimeMultiplier;
-			engine.sound_event_name = engine_operating_sound;
-
-			if (!ecs[dst].has<std::vector<ship_engine_state>>()) {
-				ecs.attachToEntity(dst, std::vector<ship_engine_state>());
-				rynx_assert(ecs[dst].has<std::vector<ship_engine_state>>(), "just added the component. must be there.");
-			}
-			ecs[dst].get<std::vector<ship_engine_state>>().emplace_back(engine);
 		};
 
-		attach_engine_to(ship_id, { moveForwardKey }, "engine_ignition_boom", "engine", 0, 5.0f, 1.6f);
-		attach_engine_to(landing_fin_left, { moveForwardKey, turnRightKey }, "", "engine", 0, 15.0f, 0.4f);
-		attach_engine_to(landing_fin_left, { moveBackwardKey, turnLeftKey}, "", "steering", rynx::math::pi, 15.0f, 0.25f);
+		using namespace ship_control;
+		attach_engine_to(ship_id, bit(forward), "engine_ignition_boom", "engine", 0, 5.0f, 1.6f);
+		attach_engine_to(landing_fin_left, bit(forward) | bit(turn_right), "", "engine", 0, 15.0f, 0.4f);
+		attach_engine_to(landing_fin_left, bit(backward) | bit(turn_left), "", "steering", rynx::math::pi, 15.0f, 0.25f);
 
-		attach_engine_to(landing_fin_right, { moveForwardKey, turnLeftKey }, "", "engine", 0, 15.0f, 0.4f);
-		attach_engine_to(landing_fin_right, { moveBackwardKey, turnRightKey}, "", "steering", rynx::math::pi, 15.0f, 0.25f);
-		
-		attach_engine_to(top_part2, { turnLeftKey }, "", "steering", +rynx::math::pi * 0.5f, 105.0f, 0.3f);
-		attach_engine_to(top_part2, { turnRightKey }, "", "steering", -rynx::math::pi * 0.5f, 105.0f, 0.3f);
+		attach_engine_to(landing_fin_right, bit(forward) | bit(turn_left), "", "engine", 0, 15.0f, 0.4f);
+		attach_engine_to(landing_fin_right, bit(backward) | bit(turn_right), "", "steering", rynx::math::pi, 15.0f, 0.25f);
+	
+		attach_engine_to(top_part2, bit(turn_left), "", "steering", +rynx::math::pi * 0.5f, 105.0f, 0.3f);
+		attach_engine_to(top_part2, bit(turn_right), "", "steering", -rynx::math::pi * 0.5f, 105.0f, 0.3f);
 
 
 		// ship is now constructed. lets build terrain next.
@@ -825,11 +1146,11 @@ int main(int argc, char** argv) {
 			if (b == a + 1 || b == a) {
 				return;
 			}
-			
+		
 			float midvalue = (heightmap[a] + heightmap[b]) * 0.5f;
 			int range = ((b - a) >> 1);
 			int midpoint = a  + range;
-			heightmap[midpoint] = midvalue + 20 * range * random(-1.0f, +0.5f);
+			heightmap[midpoint] = midvalue + 20 * range * m_random(-1.0f, +0.5f);
 
 			gen(a, midpoint);
 			gen(midpoint, b);
@@ -842,27 +1163,31 @@ int main(int argc, char** argv) {
 		gen(0, heightmap.size() / 2);
 		gen(heightmap.size() / 2, heightmap.size() - 1);
 
-		rynx::polygon p;
+		std::vector<rynx::vec3f> outline;
 		{
-			auto editor = p.edit();
 			float x_value = -500.0f;
 			for (auto y_value : heightmap) {
-				editor.push_back({ x_value, y_value, 0.0f });
+				outline.push_back({ x_value, y_value, 0.0f });
 				x_value += 10.0f;
 			}
 
-			editor.push_back({ 600.0f, +1000.0f, 0.0f });
-			editor.push_back({ -600.0f, +1000.0f, 0.0f });
+			outline.push_back({ 600.0f, +1000.0f, 0.0f });
+			outline.push_back({ -600.0f, +1000.0f, 0.0f });
 		}
 
-		std::string mesh_name("terrain");
-		meshes->erase(mesh_name);
-		auto* mesh_p = meshes->create(mesh_name, rynx::polygon_triangulation().make_boundary_mesh(p, application.textures()->textureLimits("Empty")), "Empty");
+		rynx::polygon p;
+		{
+			auto editor = p.edit();
+			for (const auto& point : outline)
+				editor.push_back(point);
+		}
+
+		rynx::graphics::mesh* mesh_p = m_config.make_terrain_mesh ? m_config.make_terrain_mesh(p) : nullptr;
 		float radius = p.radius();
 		p.invert();
-		return base_simulation.m_ecs.create(
+		auto terrain_id = ecs.create(
 			rynx::components::position({}, 0.0f),
-			rynx::components::collisions{ collisionCategoryStatic.value },
+			rynx::components::collisions{ category_static.value },
 			rynx::components::boundary(p, {}, 0.0f),
 			rynx::components::mesh(mesh_p),
 			rynx::components::radius(radius),
@@ -871,9 +1196,498 @@ int main(int argc, char** argv) {
 			rynx::components::dampening{ 0.50f, 1.0f },
 			rynx::matrix4()
 		);
+		terrain.set(terrain_id, category_static.value, outline);
+	}
+
+	// main thread, before the scheduler starts the logic frame.
+	void begin_frame(float dt) {
+		clock.time += clock.frame > 0 ? clock.dt : 0.0f;
+		clock.dt = dt;
+		++clock.frame;
+
+		// thrust is an explicit impulse, engines can't push parts that are asleep.
+		if (controls.down != 0) {
+			std::vector<rynx::ecs::id> hosts;
+			ecs.query().for_each([&hosts, down = controls.down](const ship_engine& engine) {
+				if (engine.activated_by & down)
+					hosts.emplace_back(engine.host);
+			});
+			for (auto host : hosts)
+				islands->wake(ecs, host);
+		}
+
+		continuous_collisions->begin_frame(ecs);
+
+		simulation.generate_tasks(dt);
+		timeline.begin_frame();
+	}
+
+	// main thread, after the scheduler has completed the logic frame.
+	void apply_deferred_changes() {
+		timeline.end_frame();
+		commands.playback(ecs);
+	}
+
+	// main thread, right before rendering. particles were already placed by the logic frame,
+	// everything drawn with a circle gets the tessellation its size on screen needs.
+	void update_mesh_lods() {
+		mesh_lods.update(ecs, m_pool, view);
+	}
+
+	// main thread, once per frame while no tasks are running.
+	void end_frame(float dt) {
+		relative_positions.update(ecs);
+
+		// mark time constrained entities for removal.
+		{
+			std::vector<rynx::ecs::id> ids = ecs.query().ids_if([dt](rynx::components::lifetime& time) {
+				time.value -= dt;
+				return time.value <= 0.0f;
+			});
+			
+			for (auto&& id : ids)
+				ecs.attachToEntity(id, rynx::components::dead());
+
+			if (!ids.empty())
+				versions.touch<rynx::components::dead>();
+		}
+
+		auto ids_dead = dead_entities.ids(ecs);
+
+		for (auto id : ids_dead) {
+			if (ecs[id].has<rynx::components::collisions>()) {
+				auto collisions = ecs[id].get<rynx::components::collisions>();
+				collision_detection->erase(ecs, id.value, collisions.category);
+			}
+		}
+
+		simulation.m_logic.entities_erased(*simulation.m_context, ids_dead);
+		versions.entities_erased(ecs, ids_dead);
+		islands->entities_erased(ids_dead);
+		ecs.erase(ids_dead);
+
+		// engines push their host for as long as they are winding down, an island with one running stays awake.
+		ecs.query().for_each([this](const ship_engine& engine) {
+			if ((engine.state & ship_engine::activated) || engine.activity >= 0.01f)
+				islands->keep_awake(rynx::ecs::id(engine.host));
+		});
+		islands->update(ecs, contacts, dt);
+	}
+
+	rynx::application::simulation simulation;
+	rynx::ecs& ecs;
+	std::unique_ptr<rynx::collision_detection> collision_detection;
+	rynx::collision_detection::category_id category_dynamic;
+	rynx::collision_detection::category_id category_static;
+	rynx::collision_detection::category_id category_projectiles;
+	rynx::collision_detection::category_id category_sleeping;
+	std::unique_ptr<game::island_sleeping> islands;
+	game::continuous_collisions* continuous_collisions = nullptr;
+
+	game::component_versions versions;
+	game::ecs_commands commands;
+	game::task_timeline timeline;
+	game::contact_events contacts;
+	game::static_outline terrain;
+	game::lod_view view; // set by the game from its camera, headless worlds leave it disabled.
+
+	mission_state mission;
+	game::frame_clock clock;
+	ship_controls controls;
+	rynx::ecs::id ship_body;
+
+private:
+	relative_position_updater relative_positions;
+	game::cached_query<game::types<rynx::components::dead>> dead_entities;
+	game::mesh_lod_selector mesh_lods;
+
+	game::job_pool& m_pool;
+	config m_config;
+	sound_mapper& m_sounds;
+	rynx::math::rand64 m_random;
+	int m_level = 0;
+};
+
+// headless parameter sweep. every trial flies one level in a world of its own. up to `parallel` worlds
+// are stepped together with a fixed time step, sharing one scheduler and one job pool.
+struct batch_config {
+	int trials = 0;
+	int parallel = 16;
+	float max_seconds = 60.0f;
+	float dt = 1.0f / 120.0f;
+	range<float> engine_power{ 1.0f, 1.0f }; // swept linearly from first to last trial.
+	range<float> engine_startup_time{ 1.0f, 1.0f };
+	uint64_t seed = 1;
+	game::joint_solver_config joints;
+	game::sleep_config sleep;
+	game::continuous_collision_config continuous_collisions;
+};
+
+struct trial_result {
+	int trial = 0;
+	rocket_world::level_params params;
+	bool settled = false; // the ship came to rest, same condition as mission success in game.
+	int32_t parts_alive = 0;
+	float health = 0; // remaining health of the surviving parts, 0..1
+	float flight_time = 0;
+};
+
+// scripted pilot for headless trials: brakes the descent with the forward engines, otherwise lets the ship fall.
+uint32_t descent_autopilot(const mission_state& mission) {
+	if (mission.fleet.parts_alive == 0)
+		return 0;
+	return mission.fleet.average_velocity().y < -20.0f ? ship_control::bit(ship_control::forward) : 0;
+}
+
+int run_batch(const batch_config& batch, game::core_partition& cores, const game::job_pool_config& pool_config) {
+	cores.scheduler_starts();
+	rynx::scheduler::task_scheduler scheduler;
+	game::job_pool pool(cores.fit_pool(pool_config));
+	std::printf("%zu cores: %zu scheduler threads, %zu job pool workers\n", cores.cores(), cores.scheduler_threads(), pool.worker_count());
+	rynx::sound::audio_system audio; // output is never opened, headless worlds don't play anything.
+	sound_mapper sounds;
+
+	rocket_world::config world_config;
+	world_config.headless = true;
+	world_config.joints = batch.joints;
+	world_config.sleep = batch.sleep;
+	world_config.continuous_collisions = batch.continuous_collisions;
+
+	struct slot {
+		std::unique_ptr<rocket_world> world;
+		trial_result result;
+		bool active = false;
+	};
+
+	std::vector<slot> slots(std::max(1, std::min(batch.parallel, batch.trials)));
+	for (auto& s : slots)
+		s.world = std::make_unique<rocket_world>(scheduler, pool, audio, sounds, world_config);
+
+	std::vector<trial_result> results;
+	int next_trial = 0;
+	rynx::timer wall_clock;
+
+	for (;;) {
+		bool any_active = false;
+		for (auto& s : slots) {
+			if (!s.active && next_trial < batch.trials) {
+				float t = batch.trials > 1 ? float(next_trial) / (batch.trials - 1) : 0.0f;
+				s.result = trial_result();
+				s.result.trial = next_trial;
+				s.result.params.engine_power = batch.engine_power(t);
+				s.result.params.engine_startup_time = batch.engine_startup_time(t);
+				s.result.params.terrain_seed = batch.seed + next_trial;
+				s.world->construct_level(s.result.params);
+				s.active = true;
+				++next_trial;
+			}
+
+			if (s.active) {
+				s.world->controls.down = descent_autopilot(s.world->mission);
+				s.world->begin_frame(batch.dt);
+				any_active = true;
+			}
+		}
+
+		if (!any_active)
+			break;
+
+		game::frame_arena::start_frame();
+		scheduler.start_frame();
+		scheduler.wait_until_complete();
+
+		for (auto& s : slots) {
+			if (!s.active)
+				continue;
+
+			auto& world = *s.world;
+			world.apply_deferred_changes();
+			world.end_frame(batch.dt);
+			s.result.flight_time += batch.dt;
+
+			const auto& fleet = world.mission.fleet;
+			bool settled = world.mission.success_timer > 5.0f;
+			if (settled || fleet.parts_alive == 0 || s.result.flight_time >= batch.max_seconds) {
+				s.result.settled = settled;
+				s.result.parts_alive = fleet.parts_alive;
+				s.result.health = fleet.health_max > 0 ? fleet.health_current / fleet.health_max : 0.0f;
+				results.emplace_back(s.result);
+				s.active = false;
+			}
+		}
+	}
+
+	float wall_seconds = wall_clock.time_since_last_access_us() * 0.000001f;
+	std::sort(results.begin(), results.end(), [](const trial_result& a, const trial_result& b) { return a.trial < b.trial; });
+
+	int settled_count = 0;
+	float flight_time = 0;
+	for (const auto& r : results) {
+		std::printf("trial %d: power %.3f, startup %.3f, seed %llu -> %s, success %d%%, health %.0f%%, %.2fs\n",
+			r.trial, r.params.engine_power, r.params.engine_startup_time, (unsigned long long)r.params.terrain_seed,
+			r.settled ? "settled" : (r.parts_alive == 0 ? "destroyed" : "timeout"),
+			r.parts_alive * 100 / 5, r.health * 100.0f, r.flight_time);
+		settled_count += r.settled;
+		flight_time += r.flight_time;
+	}
+
+	std::printf("%d trials in %.2fs: %.2f trials/s, %.1fx realtime, %d settled\n",
+		int(results.size()), wall_seconds, results.size() / std::max(wall_seconds, 0.001f), flight_time / std::max(wall_seconds, 0.001f), settled_count);
+	return 0;
+}
+
+// what spectators and replays see. quanta are the smallest step each channel is stored with.
+void add_state_tracks(game::state_stream::writer& writer) {
+	writer.add_track<rynx::components::position>("position", { 1.0f / 64, 1.0f / 64, 1.0f / 1024 }, [](const rynx::components::position& p, float* out) {
+		out[0] = p.value.x;
+		out[1] = p.value.y;
+		out[2] = p.angle;
+	});
+	writer.add_track<rynx::components::motion>("motion", { 1.0f / 32, 1.0f / 32 }, [](const rynx::components::motion& m, float* out) {
+		out[0] = m.velocity.x;
+		out[1] = m.velocity.y;
+	});
+	writer.add_track<health>("health", { 1.0f / 16, 1.0f / 16 }, [](const health& h, float* out) {
+		out[0] = h.current;
+		out[1] = h.max;
+	});
+	writer.add_track<rynx::components::light_omni>("light_omni", { 1.0f / 256, 1.0f / 256, 1.0f / 256, 1.0f / 64, 1.0f / 256 }, [](const rynx::components::light_omni& light, float* out) {
+		out[0] = light.color.x;
+		out[1] = light.color.y;
+		out[2] = light.color.z;
+		out[3] = light.color.w;
+		out[4] = light.ambient;
+	});
+	writer.add_track<rynx::components::color>("color", { 1.0f / 256, 1.0f / 256, 1.0f / 256, 1.0f / 256 }, [](const rynx::components::color& c, float* out) {
+		out[0] = c.value.x;
+		out[1] = c.value.y;
+		out[2] = c.value.z;
+		out[3] = c.value.w;
+	});
+}
+
+// prints what a recording costs and checks that every keyframe range decodes.
+int run_replay_info(const std::string& path) {
+	game::state_stream::reader replay;
+	if (!replay.open(path)) {
+		std::printf("could not read state stream '%s'\n", path.c_str());
+		return 1;
+	}
+
+	float minutes = replay.duration() / 60.0f;
+	std::printf("%s: %zu frames (%zu keyframes), ticks %llu..%llu, %.1fs\n",
+		path.c_str(), replay.frame_count(), replay.keyframe_count(),
+		(unsigned long long)replay.first_tick(), (unsigned long long)replay.last_tick(), replay.duration());
+	std::printf("%.1f KB on disk, %.1f KB/min, %.1f kbit/s\n",
+		replay.size_bytes() / 1024.0f,
+		minutes > 0 ? replay.size_bytes() / 1024.0f / minutes : 0.0f,
+		replay.duration() > 0 ? replay.size_bytes() * 8.0f / replay.duration() / 1000.0f : 0.0f);
+
+	for (size_t t = 0; t < replay.tracks().size(); ++t)
+		std::printf("  track %-12s %zu channels\n", replay.tracks()[t].name.c_str(), replay.tracks()[t].quanta.size());
+
+	if (!replay.seek(replay.last_tick())) {
+		std::printf("decoding failed\n");
+		return 1;
+	}
+	std::printf("last tick has %zu entities\n", replay.state().ids.size());
+	return 0;
+}
+
+int main(int argc, char** argv) {
+
+	// --task-report <frames>: print the task timeline report every <frames> frames.
+	// --task-report-json <path>: also write the report as json to <path>.
+	// --workers <n>: number of job pool workers for data parallel loops. by default the pool gets the cores
+	//   the rynx scheduler's threads leave free.
+	// --cores <first> <count>: run on cores first .. first + count - 1 only. the scheduler's threads are pinned
+	//   to the first of them and the job pool's workers to the rest.
+	// --caller-helps <0|1>: whether threads waiting for a parallel loop work on it themselves.
+	// --batch <trials>: run a headless parameter sweep instead of the game.
+	//   --batch-parallel <n>, --batch-seconds <max flight time>, --batch-seed <first terrain seed>,
+	//   --batch-power <first> <last>, --batch-startup <first> <last>: engine multipliers swept over the trials.
+	// --joint-iterations <n>: joint solver velocity iterations per frame.
+	// --max-dt <seconds>: longest logic step a slow frame may take. continuous collisions keep larger steps from tunneling.
+	// --ccd <0|1>: whether fast bodies are swept against terrain and each other.
+	// --batch-dt <seconds>: fixed logic step of batch trials.
+	// --sleep <0|1>: whether resting islands of bodies are put to sleep.
+	// --lod <0|1>: whether particles and burning debris away from the camera are updated less often.
+	// --mesh-lod <0|1>: whether circles small on screen are drawn with fewer segments.
+	// --record <path>: write a state stream of the game to <path>.
+	// --record-port <port>: stream it to a spectator listening on a local tcp port instead.
+	// --record-keyframe <ticks>: ticks between full keyframes of the stream.
+	// --replay-info <path>: print size and bandwidth of a recorded state stream and exit.
+	int task_report_interval = 0;
+	std::string task_report_json_path;
+	game::job_pool_config job_pool_config;
+	batch_config batch;
+	game::joint_solver_config joint_config;
+	game::sleep_config sleep_config;
+	game::continuous_collision_config ccd_config;
+	game::lod_policy lod_config;
+	bool mesh_lod_enabled = true;
+	float max_dt = 0.016f;
+	std::string record_path;
+	int record_port = 0;
+	uint32_t record_keyframe_interval = 300;
+	std::string replay_info_path;
+	for (int i = 1; i < argc; ++i) {
+		std::string_view arg(argv[i]);
+		if (arg == "--task-report" && i + 1 < argc) { task_report_interval = std::max(0, std::atoi(argv[++i])); }
+		else if (arg == "--task-report-json" && i + 1 < argc) { task_report_json_path = argv[++i]; }
+		else if (arg == "--workers" && i + 1 < argc) { job_pool_config.workers = std::max(0, std::atoi(argv[++i])); }
+		else if (arg == "--cores" && i + 2 < argc) { job_pool_config.first_core = std::atoi(argv[++i]); job_pool_config.core_count = unsigned(std::max(0, std::atoi(argv[++i]))); }
+		else if (arg == "--caller-helps" && i + 1 < argc) { job_pool_config.caller_helps = std::atoi(argv[++i]) != 0; }
+		else if (arg == "--batch" && i + 1 < argc) { batch.trials = std::max(0, std::atoi(argv[++i])); }
+		else if (arg == "--batch-parallel" && i + 1 < argc) { batch.parallel = std::max(1, std::atoi(argv[++i])); }
+		else if (arg == "--batch-seconds" && i + 1 < argc) { batch.max_seconds = float(std::atof(argv[++i])); }
+		else if (arg == "--batch-seed" && i + 1 < argc) { batch.seed = std::strtoull(argv[++i], nullptr, 10); }
+		else if (arg == "--batch-power" && i + 2 < argc) { batch.engine_power.begin = float(std::atof(argv[++i])); batch.engine_power.end = float(std::atof(argv[++i])); }
+		else if (arg == "--batch-startup" && i + 2 < argc) { batch.engine_startup_time.begin = float(std::atof(argv[++i])); batch.engine_startup_time.end = float(std::atof(argv[++i])); }
+		else if (arg == "--joint-iterations" && i + 1 < argc) { joint_config.iterations = uint32_t(std::max(1, std::atoi(argv[++i]))); }
+		else if (arg == "--max-dt" && i + 1 < argc) { max_dt = std::max(0.001f, float(std::atof(argv[++i]))); }
+		else if (arg == "--ccd" && i + 1 < argc) { ccd_config.enabled = std::atoi(argv[++i]) != 0; }
+		else if (arg == "--batch-dt" && i + 1 < argc) { batch.dt = std::max(0.001f, float(std::atof(argv[++i]))); }
+		else if (arg == "--sleep" && i + 1 < argc) { sleep_config.enabled = std::atoi(argv[++i]) != 0; }
+		else if (arg == "--lod" && i + 1 < argc) { lod_config.enabled = std::atoi(argv[++i]) != 0; }
+		else if (arg == "--mesh-lod" && i + 1 < argc) { mesh_lod_enabled = std::atoi(argv[++i]) != 0; }
+		else if (arg == "--record" && i + 1 < argc) { record_path = argv[++i]; }
+		else if (arg == "--record-port" && i + 1 < argc) { record_port = std::atoi(argv[++i]); }
+		else if (arg == "--record-keyframe" && i + 1 < argc) { record_keyframe_interval = uint32_t(std::max(1, std::atoi(argv[++i]))); }
+		else if (arg == "--replay-info" && i + 1 < argc) { replay_info_path = argv[++i]; }
+	}
+
+	if (!replay_info_path.empty())
+		return run_replay_info(replay_info_path);
+
+	// before any other thread starts, they all inherit the cores it leaves the process.
+	game::core_partition cores(job_pool_config);
+
+	// uses this thread services of rynx, for example in cpu performance profiling.
+	rynx::this_thread::rynx_thread_raii rynx_thread_services_required_token;
+
+	if (batch.trials > 0) {
+		batch.joints = joint_config;
+		batch.sleep = sleep_config;
+		batch.continuous_collisions = ccd_config;
+		return run_batch(batch, cores, job_pool_config);
+	}
+
+	Font fontLenka(Fonts::setFontLenka());
+	Font fontConsola(Fonts::setFontConsolaMono());
+
+	rynx::application::Application application;
+	application.openWindow(1920, 1080);
+	application.loadTextures("../textures/textures.txt");
+	application.renderer().loadDefaultMesh("Empty");
+
+	auto meshes = application.renderer().meshes();
+	{
+		meshes->create("ball", rynx::Shape::makeCircle(1.0f, 32), "Hero");
+		meshes->create("circle_empty", rynx::Shape::makeCircle(1.0f, 32), "Empty");
+
+		// coarser circles for things that are small on screen, most particles are a few pixels across.
+		for (int segments : { 16, 8, 4 }) {
+			meshes->create("ball_" + std::to_string(segments), rynx::Shape::makeCircle(1.0f, segments), "Hero");
+			meshes->create("circle_empty_" + std::to_string(segments), rynx::Shape::makeCircle(1.0f, segments), "Empty");
+		}
+	}
+
+	cores.scheduler_starts();
+	rynx::scheduler::task_scheduler scheduler;
+	job_pool_config = cores.fit_pool(job_pool_config);
+
+	std::shared_ptr<rynx::camera> camera = std::make_shared<rynx::camera>();
+	camera->setProjection(0.02f, 20000.0f, application.aspectRatio());
+
+	rynx::mapped_input gameInput(application.input());
+
+	rynx::sound::audio_system audio;
+	audio.set_default_attentuation_linear(0.01f);
+	audio.set_default_attentuation_quadratic(0.000001f);
+	audio.set_volume(1.0f);
+	audio.adjust_volume(1.5f);
+
+	sound_mapper sounds;
+
+	redraw_tracker menu_redraw;
+
+	game::job_pool job_pool(job_pool_config);
+
+	sounds.insert("engine", audio.load("../sound/bass/engine01.ogg"));
+	sounds.insert("engine", audio.load("../sound/bass/engine02.ogg"));
+	sounds.insert("engine", audio.load("../sound/bass/engine03.ogg"));
+	sounds.insert("engine", audio.load("../sound/bass/engine04.ogg"));
+	sounds.insert("engine", audio.load("../sound/bass/engine05.ogg"));
+
+	sounds.insert("steering", audio.load("../sound/ship/gas_leak01.ogg"));
+	sounds.insert("steering", audio.load("../sound/ship/gas_leak02.ogg"));
+	sounds.insert("steering", audio.load("../sound/ship/gas_leak03.ogg"));
+	sounds.insert("steering", audio.load("../sound/ship/gas_leak04.ogg"));
+	sounds.insert("steering", audio.load("../sound/ship/gas_leak05.ogg"));
+
+	sounds.insert("engine_ignition_boom", audio.load("../sound/engine_boom.ogg"));
+	sounds.insert("rocket_death", audio.load("../sound/death01.ogg"));
+	sounds.insert("rocket_death", audio.load("../sound/death02.ogg"));
+	sounds.insert("rocket_death", audio.load("../sound/death03.ogg"));
+	sounds.insert("rocket_death", audio.load("../sound/death04.ogg"));
+
+	std::array<rynx::key::logical, ship_control::count> ship_control_keys;
+	ship_control_keys[ship_control::forward] = gameInput.generateAndBindGameKey('W', "MoveForward");
+	ship_control_keys[ship_control::turn_right] = gameInput.generateAndBindGameKey('D', "TurnRight");
+	ship_control_keys[ship_control::turn_left] = gameInput.generateAndBindGameKey('A', "TurnLeft");
+	ship_control_keys[ship_control::backward] = gameInput.generateAndBindGameKey('S', "MoveBackward");
+
+	rocket_world::config world_config;
+	world_config.part_mesh = meshes->get("ball");
+	world_config.fume_mesh = meshes->get("circle_empty");
+	world_config.camera = camera;
+	world_config.joints = joint_config;
+	world_config.sleep = sleep_config;
+	world_config.continuous_collisions = ccd_config;
+	world_config.particle_lod = lod_config;
+	world_config.debris_lod = lod_config;
+	if (mesh_lod_enabled) {
+		for (std::string name : { "ball", "circle_empty" }) {
+			game::mesh_lod_chain chain;
+			chain.add_circle(meshes->get(name), 32);
+			for (int segments : { 16, 8, 4 })
+				chain.add_circle(meshes->get(name + "_" + std::to_string(segments)), segments);
+			world_config.mesh_lods.emplace_back(std::move(chain));
+		}
+	}
+	world_config.make_terrain_mesh = [&](const rynx::polygon& p) {
+		std::string mesh_name("terrain");
+		meshes->erase(mesh_name);
+		return meshes->create(mesh_name, rynx::polygon_triangulation().make_boundary_mesh(p, application.textures()->textureLimits("Empty")), "Empty");
 	};
 
-	construct_level();
+	rocket_world world(scheduler, job_pool, audio, sounds, world_config);
+	mission_state& mission = world.mission;
+	game::task_timeline& task_timeline = world.timeline;
+
+	std::unique_ptr<game::state_stream::writer> state_recorder;
+	if (!record_path.empty() || record_port > 0) {
+		std::unique_ptr<game::state_stream::sink> sink;
+		if (record_port > 0) {
+			auto socket = std::make_unique<game::state_stream::socket_sink>(uint16_t(record_port));
+			if (!socket->is_open())
+				std::cout << "state stream: nobody listening on port " << record_port << std::endl;
+			sink = std::move(socket);
+		}
+		else {
+			auto file = std::make_unique<game::state_stream::file_sink>(record_path);
+			if (!file->is_open())
+				std::cout << "state stream: could not open " << record_path << std::endl;
+			sink = std::move(file);
+		}
+		state_recorder = std::make_unique<game::state_stream::writer>(std::move(sink), record_keyframe_interval);
+		add_state_tracks(*state_recorder);
+	}
+
+	rynx::smooth<rynx::vec3<float>> cameraPosition(0.0f, 0.0f, 300.0f);
+
+	world.construct_level();
 
 	// setup some debug controls
 	float sleepTime = 0.9f;
@@ -885,7 +1699,7 @@ int main(int argc, char** argv) {
 
 	auto menuCamera = std::make_shared<rynx::camera>();
 
-	gameInput.generateAndBindGameKey(gameInput.getMouseKeyPhysical(0), "menuCursorActivation");
+	auto menuCursorActivation = gameInput.generateAndBindGameKey(gameInput.getMouseKeyPhysical(0), "menuCursorActivation");
 
 	auto cameraUp = gameInput.generateAndBindGameKey('I', "cameraUp");
 	auto cameraLeft = gameInput.generateAndBindGameKey('J', "cameraLeft");
@@ -909,7 +1723,7 @@ int main(int argc, char** argv) {
 
 	rynx::graphics::screenspace_draws(); // initialize gpu buffers for screenspace ops.
 	rynx::application::renderer render(application, camera);
-	auto debugDrawState = base_simulation.m_context->access_state().generate_state_id();
+	auto debugDrawState = world.simulation.m_context->access_state().generate_state_id();
 	debugDrawState.disable();
 	render.light_global_ambient({0.3f, 0.3, 0.3f, 1.0f});
 	render.debug_draw_binary_config(debugDrawState);
@@ -925,6 +1739,7 @@ int main(int argc, char** argv) {
 
 	audio.open_output_device();
 
+
 	rynx::timer frame_timer_dt;
 	float dt = 1.0f / 120.0f;
 	while (!application.isExitRequested()) {
@@ -962,6 +1777,8 @@ int main(int argc, char** argv) {
 			camera->setDirection(direction);
 			camera->setProjection(0.02f, 2000.0f, application.aspectRatio());
 			camera->rebuild_view_matrix();
+			const auto& projection = camera->getProjection();
+			world.view = game::lod_view::from_frustum(camera->position(), camera->local_forward(), camera->local_left(), 1.0f / projection.data[0], 1.0f / projection.data[5], 1080.0f);
 		}
 
 		{
@@ -978,11 +1795,16 @@ int main(int argc, char** argv) {
 		timer.reset();
 		{
 			rynx_profile("Main", "Construct frame tasks");
-			base_simulation.generate_tasks(dt);
+			world.controls.down = 0;
+			for (uint32_t i = 0; i < ship_control::count; ++i) {
+				world.controls.down |= uint32_t(gameInput.isKeyDown(ship_control_keys[i])) << i;
+			}
+			world.begin_frame(dt);
 		}
 
 		{
 			rynx_profile("Main", "Start scheduler");
+			game::frame_arena::start_frame();
 			scheduler.start_frame();
 		}
 
@@ -991,6 +1813,20 @@ int main(int argc, char** argv) {
 			scheduler.wait_until_complete();
 		}
 
+		{
+			rynx_profile("Main", "Apply deferred ecs changes");
+			world.apply_deferred_changes();
+		}
+
+		if (task_report_interval > 0 && task_timeline.frames() >= uint64_t(task_report_interval)) {
+			std::cout << task_timeline.report_text() << std::flush;
+			if (!task_report_json_path.empty()) {
+				std::ofstream json(task_report_json_path, std::ios::trunc);
+				json << task_timeline.report_json();
+			}
+			task_timeline.reset_summary();
+		}
+
 		auto logic_time_us = timer.time_since_last_access_us();
 		logic_time.observe_value(logic_time_us / 1000.0f); // down to milliseconds.
 
@@ -1005,48 +1841,24 @@ int main(int argc, char** argv) {
 
 			{
 				rynx_profile("Main", "prepare");
-				render.prepare(base_simulation.m_context);
+				world.update_mesh_lods();
+				render.prepare(world.simulation.m_context);
+				game::frame_arena::start_frame();
 				scheduler.start_frame();
 
 				// while waiting for computing to be completed, draw menus.
 				{
 					rynx_profile("Main", "Menus");
-					fbo_menu->bind_as_output();
-					fbo_menu->clear();
-
-					application.renderer().setDepthTest(false);
-
-					// 2, 2 is the size of the entire screen (in case of 1:1 aspect ratio) for menu camera. left edge is [-1, 0], top right is [+1, +1], etc.
-					// so we make it size 2,2 to cover all of that. and then take aspect ratio into account by dividing the y-size.
-					root.scale_local({ 2 , 2 / application.aspectRatio(), 0 });
-					menuCamera->setProjection(0.01f, 50.0f, application.aspectRatio());
-					menuCamera->setPosition({ 0, 0, 1 });
-					menuCamera->tick(1.0f);
-					menuCamera->rebuild_view_matrix();
-
-					application.renderer().setCamera(menuCamera);
-					application.renderer().cameraToGPU();
-					root.visualise(application.renderer());
-
-					auto get_min_avg_max = [](rynx::numeric_property<float>& prop) {
-						return std::to_string(prop.min()) + "/" + std::to_string(prop.avg()) + "/" + std::to_string(prop.max()) + "ms";
-					};
-
-					auto player_positions = ecs.query().in<health>().gather<rynx::components::position, rynx::components::motion>();
-
-					rynx::vec3f player_position;
-					rynx::vec3f player_velocity;
-					for (auto&& data_line : player_positions) { player_position += std::get<0>(data_line).value; player_velocity += std::get<1>(data_line).velocity; }
 
 					static rynx::floats4 success_color(0, 0, 0, 0);
 					static std::string game_result_text;
 					static std::string game_result_desc;
-					int32_t rocket_parts_alive = ecs.query().in<health>().count();
+					int32_t rocket_parts_alive = mission.fleet.parts_alive;
 					int32_t success_rate = rocket_parts_alive * 100 / 5;
 
 					if (rocket_parts_alive > 0) {
-						player_position *= 1.0f / rocket_parts_alive;
-						player_velocity *= 1.0f / rocket_parts_alive;
+						rynx::vec3f player_position = mission.fleet.centroid();
+						rynx::vec3f player_velocity = mission.fleet.average_velocity();
 						player_position.z = camera->position().z;
 
 						float linear_speed = player_velocity.length();
@@ -1057,7 +1869,7 @@ int main(int argc, char** argv) {
 						cameraPosition->z = 300;
 					}
 
-					if (g_success_timer > 2.0f) {
+					if (mission.success_timer > 2.0f) {
 						float sqr_success = success_rate * success_rate * 0.01f * 0.01f;
 						success_color += (rynx::floats4(1.0f - sqr_success, sqr_success, 0.0f, 1.0f) - success_color) * dt * 3.0f;
 						if (success_rate > 99) {
@@ -1077,17 +1889,54 @@ int main(int argc, char** argv) {
 						success_color += (rynx::floats4(0, 0, 0, 0) - success_color) * dt * 3.0f;
 					}
 
-					rynx::graphics::renderable_text game_res_desc_text;
-					rynx::graphics::renderable_text game_res_result_text;
+					// the menu framebuffer is only redrawn when something that ends up in it has changed.
+					// color is observed at rgba8 precision, smaller changes are not visible in the framebuffer anyway.
+					auto to_rgba8 = [](rynx::floats4 c) {
+						auto channel = [](float v) { return static_cast<uint32_t>(std::clamp(v, 0.0f, 1.0f) * 255.0f + 0.5f); };
+						return channel(c.x) | (channel(c.y) << 8) | (channel(c.z) << 16) | (channel(c.w) << 24);
+					};
+
+					// the cursor itself is not drawn into the menu, only whether it is over the menu and pressing it.
+					bool menu_hovered = std::abs(mousePos.x) <= 1.0f && std::abs(mousePos.y) <= 1.0f;
+
+					menu_redraw
+						.observe(application.aspectRatio())
+						.observe(menu_hovered)
+						.observe(menu_hovered && gameInput.isKeyDown(menuCursorActivation))
+						.observe(to_rgba8(success_color))
+						.observe(game_result_desc)
+						.observe(game_result_text);
+
+					application.renderer().setDepthTest(false);
+
+					if (menu_redraw.needs_redraw(dt)) {
+						fbo_menu->bind_as_output();
+						fbo_menu->clear();
 
-					game_res_desc_text.pos({ 0.0f, 0.15f, 0.0f }).color({ success_color }).align_center().font(&fontConsola).font_size(0.15f);
-					game_res_result_text = game_res_desc_text;
+						// 2, 2 is the size of the entire screen (in case of 1:1 aspect ratio) for menu camera. left edge is [-1, 0], top right is [+1, +1], etc.
+						// so we make it size 2,2 to cover all of that. and then take aspect ratio into account by dividing the y-size.
+						root.scale_local({ 2 , 2 / application.aspectRatio(), 0 });
+						menuCamera->setProjection(0.01f, 50.0f, application.aspectRatio());
+						menuCamera->setPosition({ 0, 0, 1 });
+						menuCamera->tick(1.0f);
+						menuCamera->rebuild_view_matrix();
 
-					game_res_desc_text.text(game_result_desc);
-					game_res_result_text.text(game_result_text).pos({ 0.0f, 0.0f, 0.0f});
+						application.renderer().setCamera(menuCamera);
+						application.renderer().cameraToGPU();
+						root.visualise(application.renderer());
 
-					application.renderer().drawText(game_res_desc_text);
-					application.renderer().drawText(game_res_result_text);
+						rynx::graphics::renderable_text game_res_desc_text;
+						rynx::graphics::renderable_text game_res_result_text;
+
+						game_res_desc_text.pos({ 0.0f, 0.15f, 0.0f }).color({ success_color }).align_center().font(&fontConsola).font_size(0.15f);
+						game_res_result_text = game_res_desc_text;
+
+						game_res_desc_text.text(game_result_desc);
+						game_res_result_text.text(game_result_text).pos({ 0.0f, 0.0f, 0.0f });
+
+						application.renderer().drawText(game_res_desc_text);
+						application.renderer().drawText(game_res_result_text);
+					}
 				}
 
 				scheduler.wait_until_complete();
@@ -1114,48 +1963,26 @@ int main(int argc, char** argv) {
 
 				total_time.observe_value((logic_time_us + render_time_us + swap_time_us) / 1000.0f);
 			}
-
-			ecs.query().for_each([&ecs](rynx::components::position& pos, rynx::components::position_relative relative_pos) {
-				if (!ecs.exists(relative_pos.host))
-					return;
-
-				const auto& host_pos = ecs[relative_pos.host].get<rynx::components::position>();
-				pos.value = host_pos.value + rynx::math::rotatedXY(relative_pos.relative_pos, host_pos.angle);
-			});
 		}
 
 		{
 			rynx_profile("Main", "Clean up dead entitites");
-			dt = std::min(0.016f, std::max(0.001f, frame_timer_dt.time_since_last_access_ms() * 0.001f));
-
-			// mark time constrained entities for removal.
-			{
-				std::vector<rynx::ecs::id> ids = ecs.query().ids_if([dt](rynx::components::lifetime& time) {
-					time.value -= dt;
-					return time.value <= 0.0f;
-				});
-				
-				for (auto&& id : ids)
-					ecs.attachToEntity(id, rynx::components::dead());
-			}
-
-			auto ids_dead = ecs.query().in<rynx::components::dead>().ids();
+			dt = std::min(max_dt, std::max(0.001f, frame_timer_dt.time_since_last_access_ms() * 0.001f));
 
-			for (auto id : ids_dead) {
-				if (ecs[id].has<rynx::components::collisions>()) {
-					auto collisions = ecs[id].get<rynx::components::collisions>();
-					collisionDetection.erase(ecs, id.value, collisions.category);
-				}
-			}
+			world.end_frame(dt);
+		}
 
-			base_simulation.m_logic.entities_erased(*base_simulation.m_context, ids_dead);
-			ecs.erase(ids_dead);
+		if (state_recorder) {
+			rynx_profile("Main", "Record state stream");
+			state_recorder->capture(world.ecs, world.clock.frame, world.clock.dt);
 		}
 
-		if (g_success_timer > 5.0f) {
-			construct_level();
-			g_success_timer = 0.0f;
+		if (mission.success_timer > 5.0f) {
+			world.construct_level();
 		}
 	}
+
+	if (state_recorder)
+		std::cout << state_recorder->report() << std::flush;
 	return 0;
 }
@@ -0,0 +1,98 @@
+
+#pragma once
+
+#include <rynx/tech/components.hpp>
+#include <rynx/tech/ecs.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "cached_query.hpp"
+#include "parallel.hpp"
+#include "update_lod.hpp"
+
+namespace game {
+
+	// versions of one mesh from coarsest to finest, each good up to some radius on screen.
+	// selection is a pure function of the screen radius, so it can be checked without a renderer.
+	class mesh_lod_chain {
+	public:
+		struct level {
+			rynx::graphics::mesh* mesh = nullptr;
+			float max_screen_radius = 0; // in pixels
+		};
+
+		// a circle of `segments` segments deviates from the true circle by r * (1 - cos(pi / segments)).
+		// it is used while that stays under max_error pixels.
+		mesh_lod_chain& add_circle(rynx::graphics::mesh* mesh, int segments, float max_error = 0.5f) {
+			float deviation = 1.0f - std::cos(3.14159265f / float(std::max(segments, 3)));
+			return add(mesh, max_error / deviation);
+		}
+
+		mesh_lod_chain& add(rynx::graphics::mesh* mesh, float max_screen_radius) {
+			m_levels.push_back({ mesh, max_screen_radius });
+			std::sort(m_levels.begin(), m_levels.end(), [](const level& a, const level& b) { return a.max_screen_radius < b.max_screen_radius; });
+			return *this;
+		}
+
+		// coarsest level that is good enough, the finest one for anything larger.
+		uint32_t select(float screen_radius) const {
+			for (uint32_t i = 0; i + 1 < m_levels.size(); ++i)
+				if (screen_radius <= m_levels[i].max_screen_radius)
+					return i;
+			return uint32_t(m_levels.size()) - 1;
+		}
+
+		const std::vector<level>& levels() const { return m_levels; }
+
+	private:
+		std::vector<level> m_levels;
+	};
+
+	// swaps the mesh of every entity drawn with a mesh of some chain to the level that fits its size on screen.
+	// main thread only, after particles were placed for the frame and before the renderer builds its instances.
+	class mesh_lod_selector {
+	public:
+		mesh_lod_selector(component_versions& versions) : m_meshes(versions) {}
+
+		void add_chain(mesh_lod_chain chain) {
+			uint32_t index = uint32_t(m_chains.size());
+			for (uint32_t level = 0; level < chain.levels().size(); ++level)
+				m_lookup[chain.levels()[level].mesh] = { index, level };
+			m_chains.emplace_back(std::move(chain));
+		}
+
+		void update(rynx::ecs& ecs, job_pool& pool, const lod_view& view) {
+			if (m_chains.empty() || !view.enabled || view.pixels_per_unit <= 0.0f)
+				return;
+
+			const auto& ids = m_meshes.ids(ecs);
+			pool.parallel_for(ids.size(), 1024, [&](size_t, size_t begin, size_t end) {
+				for (size_t i = begin; i < end; ++i) {
+					auto entity = ecs[ids[i]];
+					auto& mesh = entity.get<rynx::components::mesh>();
+					auto it = m_lookup.find(mesh.m);
+					if (it == m_lookup.end())
+						continue;
+
+					const auto& chain = m_chains[it->second.chain];
+					float screen_radius = entity.get<const rynx::components::radius>().r * view.pixels_per_unit;
+					mesh.m = chain.levels()[chain.select(screen_radius)].mesh;
+				}
+			});
+		}
+
+	private:
+		struct chain_level {
+			uint32_t chain;
+			uint32_t level;
+		};
+
+		cached_query<types<rynx::components::mesh, rynx::components::radius>> m_meshes;
+		std::vector<mesh_lod_chain> m_chains;
+		std::unordered_map<const rynx::graphics::mesh*, chain_level> m_lookup;
+	};
+}
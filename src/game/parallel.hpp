@@ -0,0 +1,438 @@
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace game {
+
+	struct job_pool_config {
+		// the pool's workers are threads of their own, next to the rynx scheduler's threads. negative sizes
+		// the pool to the cores the scheduler's threads leave free (see core_partition), so the two don't
+		// oversubscribe the host. with no cores left the pool has no workers and loops run on the calling
+		// scheduler thread. an explicit count (--workers) trades contention for loop throughput.
+		int workers = -1;
+
+		// cores the whole process runs on, first_core .. first_core + core_count - 1, shared between the
+		// scheduler and the pool by core_partition. negative leaves the process on every core it may use.
+		// lets several game instances on one host keep to separate cores.
+		int first_core = -1;
+		unsigned core_count = 0;
+
+		// whether threads calling parallel_for work on their own loop while waiting for it.
+		// when off, loop work only runs on the (possibly pinned) pool workers and callers just sleep.
+		// a pool without workers always runs loops on the caller, and so do the pool's own workers
+		// calling parallel_for from inside a loop, a sleeping worker could leave its loop without anyone to run it.
+		bool caller_helps = true;
+
+		// worker i is pinned to worker_cores[i], workers past the end are not pinned. set by core_partition.
+		std::vector<unsigned> worker_cores;
+	};
+
+	// the cores of the process split between the rynx scheduler and the job pool. the scheduler starts its
+	// own threads when it is constructed and knows nothing about the pool, so the pool is fitted around it.
+	// create the partition first thing in main, it restricts the process to the configured cores and threads
+	// started later inherit that. call scheduler_starts() right before constructing the scheduler and
+	// fit_pool() right after, threads started in between are taken to be the scheduler's. they get the
+	// first cores of the set, the pool's workers the rest. counting and pinning the scheduler's threads
+	// needs linux, elsewhere the scheduler is assumed to run one thread per core.
+	class core_partition {
+	public:
+		core_partition(const job_pool_config& config) {
+			m_cores = process_cores();
+			if (config.first_core >= 0 && config.core_count > 0) {
+				std::vector<unsigned> wanted;
+				for (unsigned i = 0; i < config.core_count; ++i) {
+					unsigned core = unsigned(config.first_core) + i;
+					if (std::find(m_cores.begin(), m_cores.end(), core) != m_cores.end())
+						wanted.emplace_back(core);
+					else
+						std::fprintf(stderr, "core partition: core %u is not available, left out\n", core);
+				}
+				if (!wanted.empty() && restrict_process(wanted)) {
+					m_cores = wanted;
+					m_pin = true;
+				}
+			}
+		}
+
+		void scheduler_starts() {
+			m_threads_before = process_threads();
+		}
+
+		job_pool_config fit_pool(job_pool_config config) {
+			std::vector<long> started;
+			for (long tid : process_threads())
+				if (std::find(m_threads_before.begin(), m_threads_before.end(), tid) == m_threads_before.end())
+					started.emplace_back(tid);
+#if defined(__linux__)
+			m_scheduler_threads = started.size();
+#else
+			m_scheduler_threads = m_cores.size();
+#endif
+
+			if (config.workers < 0)
+				config.workers = int(m_cores.size() > m_scheduler_threads ? m_cores.size() - m_scheduler_threads : 0);
+
+			if (m_pin) {
+				// workers take cores from the back, the scheduler's threads share whatever is in front of them.
+				size_t pool_cores = std::min(size_t(config.workers), m_cores.size() - 1);
+				size_t scheduler_cores = m_cores.size() - pool_cores;
+				config.worker_cores.assign(m_cores.end() - pool_cores, m_cores.end());
+				for (size_t i = 0; i < started.size(); ++i)
+					pin_thread(started[i], m_cores[i % scheduler_cores]);
+			}
+			return config;
+		}
+
+		size_t cores() const { return m_cores.size(); }
+		size_t scheduler_threads() const { return m_scheduler_threads; }
+
+	private:
+		static std::vector<unsigned> process_cores() {
+			std::vector<unsigned> cores;
+#if defined(__linux__)
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			if (sched_getaffinity(0, sizeof(set), &set) == 0)
+				for (unsigned core = 0; core < CPU_SETSIZE; ++core)
+					if (CPU_ISSET(core, &set))
+						cores.emplace_back(core);
+#endif
+			if (cores.empty())
+				for (unsigned core = 0; core < std::max(1u, std::thread::hardware_concurrency()); ++core)
+					cores.emplace_back(core);
+			return cores;
+		}
+
+		// the calling thread's affinity is what threads started later inherit.
+		static bool restrict_process(const std::vector<unsigned>& cores) {
+#if defined(_WIN32)
+			DWORD_PTR mask = 0;
+			for (unsigned core : cores)
+				mask |= DWORD_PTR(1) << core;
+			return SetProcessAffinityMask(GetCurrentProcess(), mask) != 0;
+#elif defined(__linux__)
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			for (unsigned core : cores)
+				CPU_SET(core, &set);
+			return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+			(void)cores;
+			return false;
+#endif
+		}
+
+		static std::vector<long> process_threads() {
+			std::vector<long> threads;
+#if defined(__linux__)
+			std::error_code error;
+			for (const auto& entry : std::filesystem::directory_iterator("/proc/self/task", error))
+				threads.emplace_back(std::strtol(entry.path().filename().c_str(), nullptr, 10));
+#endif
+			return threads;
+		}
+
+		static void pin_thread(long tid, unsigned core) {
+#if defined(__linux__)
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(core, &set);
+			sched_setaffinity(pid_t(tid), sizeof(set), &set);
+#else
+			(void)tid;
+			(void)core;
+#endif
+		}
+
+		std::vector<unsigned> m_cores;
+		std::vector<long> m_threads_before;
+		size_t m_scheduler_threads = 0;
+		bool m_pin = false;
+	};
+
+	// worker pool for data parallel loops inside frame tasks.
+	// every worker has its own deque of chunk ranges. a worker splits the range it is working on and keeps
+	// the halves in its own deque, idle workers steal the oldest (largest) ranges from the other deques.
+	class job_pool {
+	public:
+		// a pool that was not fitted with core_partition and has no explicit size gets a worker per core but one.
+		job_pool(job_pool_config config = {}) : m_config(config) {
+			unsigned workers = config.workers >= 0 ? unsigned(config.workers) : std::max(1u, std::thread::hardware_concurrency()) - 1;
+			for (unsigned i = 0; i < workers; ++i)
+				m_queues.emplace_back(std::make_unique<queue>());
+
+			for (unsigned i = 0; i < workers; ++i) {
+				m_workers.emplace_back([this, i]() { worker_loop(i); });
+				if (i < config.worker_cores.size())
+					pin_to_core(m_workers.back(), config.worker_cores[i]);
+			}
+		}
+
+		~job_pool() {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop = true;
+			}
+			m_work_available.notify_all();
+			for (auto& worker : m_workers)
+				worker.join();
+		}
+
+		job_pool(const job_pool&) = delete;
+		job_pool& operator = (const job_pool&) = delete;
+
+		size_t worker_count() const { return m_workers.size(); }
+		const job_pool_config& config() const { return m_config; }
+
+		// number of chunks parallel_for splits a loop into, for callers keeping per chunk results.
+		static size_t chunk_count(size_t count, size_t grain_size) {
+			grain_size = std::max<size_t>(grain_size, 1);
+			return (count + grain_size - 1) / grain_size;
+		}
+
+		// calls op(chunk_index, begin, end) for consecutive chunks of at most grain_size items.
+		// small loops that fit in one chunk run inline without touching the pool at all.
+		template<typename F>
+		void parallel_for(size_t count, size_t grain_size, F&& op) {
+			grain_size = std::max<size_t>(grain_size, 1);
+			size_t num_chunks = chunk_count(count, grain_size);
+			if (num_chunks <= 1 || m_workers.empty()) {
+				for (size_t chunk = 0; chunk < num_chunks; ++chunk) {
+					op(chunk, chunk * grain_size, std::min(count, (chunk + 1) * grain_size));
+				}
+				return;
+			}
+
+			job_t<std::decay_t<F>> job(op, count, grain_size, num_chunks);
+
+			// one contiguous range per worker to start with, stealing evens out the rest.
+			size_t num_ranges = std::min(num_chunks, m_queues.size());
+			for (size_t i = 0; i < num_ranges; ++i) {
+				push(i, { &job, num_chunks * i / num_ranges, num_chunks * (i + 1) / num_ranges });
+			}
+			wake_workers();
+
+			if (m_config.caller_helps || current_pool() == this) {
+				item work;
+				size_t victim = 0;
+				while (steal_from_job(&job, work, victim))
+					run(work, victim);
+			}
+
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_job_done.wait(lock, [&job, num_chunks]() { return job.chunks_done.load(std::memory_order_acquire) == num_chunks; });
+		}
+
+	private:
+		struct job_base {
+			job_base(size_t count, size_t grain_size, size_t num_chunks) : count(count), grain_size(grain_size), num_chunks(num_chunks) {}
+			virtual ~job_base() {}
+			virtual void run_chunk(size_t chunk) = 0;
+
+			const size_t count;
+			const size_t grain_size;
+			const size_t num_chunks;
+			std::atomic<size_t> chunks_done = 0;
+		};
+
+		template<typename F>
+		struct job_t : public job_base {
+			job_t(F& op, size_t count, size_t grain_size, size_t num_chunks) : job_base(count, grain_size, num_chunks), op(op) {}
+			void run_chunk(size_t chunk) override {
+				op(chunk, chunk * grain_size, std::min(count, (chunk + 1) * grain_size));
+			}
+			F& op;
+		};
+
+		// chunks [begin, end) of a job.
+		struct item {
+			job_base* job = nullptr;
+			size_t begin = 0;
+			size_t end = 0;
+		};
+
+		struct queue {
+			std::mutex mutex;
+			std::deque<item> items;
+		};
+
+		void push(size_t queue_index, item work) {
+			auto& q = *m_queues[queue_index];
+			{
+				std::lock_guard<std::mutex> lock(q.mutex);
+				q.items.emplace_back(work);
+			}
+			m_pending.fetch_add(1, std::memory_order_release);
+		}
+
+		// taking the lock orders the wake up after any worker that is just about to check m_pending and sleep.
+		void wake_workers() {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+			}
+			m_work_available.notify_all();
+		}
+
+		// owner end, most recently split range is the one closest to what the worker just ran.
+		bool pop(size_t queue_index, item& work) {
+			auto& q = *m_queues[queue_index];
+			std::lock_guard<std::mutex> lock(q.mutex);
+			if (q.items.empty())
+				return false;
+			work = q.items.back();
+			q.items.pop_back();
+			m_pending.fetch_sub(1, std::memory_order_relaxed);
+			return true;
+		}
+
+		bool steal(size_t thief, item& work, size_t& victim) {
+			for (size_t i = 1; i <= m_queues.size(); ++i) {
+				victim = (thief + i) % m_queues.size();
+				auto& q = *m_queues[victim];
+				std::lock_guard<std::mutex> lock(q.mutex);
+				if (!q.items.empty()) {
+					work = q.items.front();
+					q.items.pop_front();
+					m_pending.fetch_sub(1, std::memory_order_relaxed);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// callers only help with their own loop, they must not get stuck running someone else's chunks.
+		bool steal_from_job(job_base* job, item& work, size_t& victim) {
+			for (victim = 0; victim < m_queues.size(); ++victim) {
+				auto& q = *m_queues[victim];
+				std::lock_guard<std::mutex> lock(q.mutex);
+				auto it = std::find_if(q.items.begin(), q.items.end(), [job](const item& i) { return i.job == job; });
+				if (it != q.items.end()) {
+					work = *it;
+					q.items.erase(it);
+					m_pending.fetch_sub(1, std::memory_order_relaxed);
+					return true;
+				}
+			}
+			return false;
+		}
+
+		// halves of the range are left in queue_index for others to steal, the first chunk is run right away.
+		void run(item work, size_t queue_index) {
+			bool pushed = false;
+			while (work.end - work.begin > 1) {
+				size_t mid = work.begin + (work.end - work.begin) / 2;
+				push(queue_index, { work.job, mid, work.end });
+				work.end = mid;
+				pushed = true;
+			}
+
+			if (pushed)
+				wake_workers();
+
+			job_base* job = work.job;
+			size_t num_chunks = job->num_chunks;
+			job->run_chunk(work.begin);
+
+			// the owner may return as soon as it sees the last chunk done, the job must not be touched after this.
+			if (job->chunks_done.fetch_add(1, std::memory_order_acq_rel) + 1 == num_chunks) {
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_job_done.notify_all();
+			}
+		}
+
+		// the pool the calling thread is a worker of, if any.
+		static job_pool*& current_pool() {
+			thread_local job_pool* pool = nullptr;
+			return pool;
+		}
+
+		void worker_loop(size_t index) {
+			current_pool() = this;
+			for (;;) {
+				item work;
+				size_t victim = index;
+				if (pop(index, work) || steal(index, work, victim)) {
+					// stolen ranges are split into the thief's own deque.
+					run(work, index);
+					continue;
+				}
+
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_work_available.wait(lock, [this]() { return m_stop || m_pending.load(std::memory_order_acquire) > 0; });
+				if (m_stop)
+					return;
+			}
+		}
+
+		// cores that don't exist are not wrapped around onto ones that do, the worker is left unpinned instead.
+		static void pin_to_core(std::thread& thread, unsigned core) {
+			unsigned cores = std::thread::hardware_concurrency();
+			if (cores != 0 && core >= cores) {
+				std::fprintf(stderr, "job pool: core %u does not exist (%u cores), worker left unpinned\n", core, cores);
+				return;
+			}
+#if defined(_WIN32)
+			SetThreadAffinityMask(thread.native_handle(), DWORD_PTR(1) << core);
+#elif defined(__linux__)
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			CPU_SET(core, &set);
+			pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+			(void)thread;
+#endif
+		}
+
+		job_pool_config m_config;
+		std::vector<std::unique_ptr<queue>> m_queues;
+		std::vector<std::thread> m_workers;
+		std::atomic<int64_t> m_pending = 0;
+
+		std::mutex m_mutex;
+		std::condition_variable m_work_available;
+		std::condition_variable m_job_done;
+		bool m_stop = false;
+	};
+
+	// reduces count items in chunks of grain_size. accumulate(partial, begin, end) folds a range of items
+	// into a chunk local partial, combine(result, partial) merges partials. partials are merged in chunk
+	// order, so floating point results are the same no matter how chunks were spread over workers.
+	template<typename T, typename Accumulate, typename Combine>
+	T parallel_reduce(job_pool& pool, size_t count, size_t grain_size, const T& identity, Accumulate&& accumulate, Combine&& combine) {
+		std::vector<T> partials(job_pool::chunk_count(count, grain_size), identity);
+		pool.parallel_for(count, grain_size, [&](size_t chunk, size_t begin, size_t end) {
+			accumulate(partials[chunk], begin, end);
+		});
+
+		T result = identity;
+		for (const auto& partial : partials)
+			combine(result, partial);
+		return result;
+	}
+}
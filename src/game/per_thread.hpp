@@ -0,0 +1,44 @@
+
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace game {
+
+	// one instance of T per thread that touches it. instances are owned by a process wide registry,
+	// so a main thread sync point can visit all of them (while no tasks are running).
+	template<typename T>
+	class per_thread {
+	public:
+		static T& local() {
+			thread_local T* instance = registry().add();
+			return *instance;
+		}
+
+		template<typename F>
+		static void for_each(F&& op) {
+			auto& reg = registry();
+			std::lock_guard<std::mutex> lock(reg.mutex);
+			for (auto& instance : reg.instances)
+				op(*instance);
+		}
+
+	private:
+		struct instance_registry {
+			T* add() {
+				std::lock_guard<std::mutex> lock(mutex);
+				return instances.emplace_back(std::make_unique<T>()).get();
+			}
+
+			std::mutex mutex;
+			std::vector<std::unique_ptr<T>> instances;
+		};
+
+		static instance_registry& registry() {
+			static instance_registry reg;
+			return reg;
+		}
+	};
+}
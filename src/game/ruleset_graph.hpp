@@ -0,0 +1,155 @@
+
+#pragma once
+
+#include <rynx/application/logic.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "task_timeline.hpp"
+
+namespace game {
+
+	// ordering between rulesets, declared once for both the rynx scheduler and the task timeline.
+	// timeline nodes belong to the ruleset that declared them as owner. rulesets without instrumented tasks
+	// are passed through, so tasks of their predecessors get ordered before tasks of their successors.
+	class ruleset_graph {
+	public:
+		using ruleset = rynx::application::logic::iruleset;
+
+		ruleset_graph(task_timeline& timeline) : m_timeline(timeline) {}
+
+		// `after` runs once `before` has completed.
+		ruleset_graph& order(ruleset& before, ruleset& after) {
+			after.depends_on(before);
+			m_edges.push_back({ &before, &after });
+			return *this;
+		}
+
+		// a ruleset that doesn't need to be ordered against any other.
+		ruleset_graph& add(ruleset& r) {
+			m_unordered.emplace_back(&r);
+			return *this;
+		}
+
+		// rulesets that add their tasks to the scheduler themselves, like the engine ones, can't record their tasks.
+		// they get timed as one timeline span instead: from a marker task that runs once the ruleset's predecessors
+		// are done, to a marker task that runs after the ruleset. the returned markers must be added to the simulation.
+		struct span_markers {
+			std::unique_ptr<ruleset> begin;
+			std::unique_ptr<ruleset> end;
+		};
+
+		span_markers measure(ruleset& r, std::string_view name) {
+			auto n = m_timeline.declare_span(name, &r);
+			span_markers markers{
+				std::make_unique<span_marker>(m_timeline, n, true),
+				std::make_unique<span_marker>(m_timeline, n, false)
+			};
+			r.depends_on(*markers.begin);
+			markers.end->depends_on(r);
+			m_measured.push_back({ &r, markers.begin.get() });
+			m_unordered.emplace_back(&r);
+			return markers;
+		}
+
+		// call once all rulesets are ordered. every instrumented task must belong to an ordered ruleset,
+		// otherwise the critical path would silently miss the edges around it.
+		void declare_timeline_edges() {
+			std::vector<const ruleset*> rulesets(m_unordered.begin(), m_unordered.end());
+			for (const auto& e : m_edges) {
+				rulesets.emplace_back(e.before);
+				rulesets.emplace_back(e.after);
+			}
+			std::sort(rulesets.begin(), rulesets.end());
+			rulesets.erase(std::unique(rulesets.begin(), rulesets.end()), rulesets.end());
+
+			// the span starts when its ruleset could start, not when the begin marker happens to get scheduled.
+			for (const auto& m : m_measured)
+				for (const auto& e : m_edges)
+					if (e.after == m.target)
+						m.begin->depends_on(*e.before);
+
+			for (task_timeline::node n = 0; n < m_timeline.size(); ++n) {
+				rynx_assert(std::binary_search(rulesets.begin(), rulesets.end(), m_timeline.owner(n)), "instrumented task is not part of the ruleset graph");
+			}
+
+			for (const ruleset* from : rulesets) {
+				auto from_nodes = nodes_of(from);
+				if (from_nodes.empty())
+					continue;
+
+				// walk successors until rulesets with instrumented tasks of their own.
+				std::vector<const ruleset*> visited;
+				std::vector<const ruleset*> open{ from };
+				while (!open.empty()) {
+					const ruleset* current = open.back();
+					open.pop_back();
+					for (const auto& e : m_edges) {
+						if (e.before != current || std::find(visited.begin(), visited.end(), e.after) != visited.end())
+							continue;
+
+						visited.emplace_back(e.after);
+						auto to_nodes = nodes_of(e.after);
+						if (to_nodes.empty()) {
+							open.emplace_back(e.after);
+							continue;
+						}
+
+						for (auto before : from_nodes)
+							for (auto after : to_nodes)
+								m_timeline.depends_on(after, before);
+					}
+				}
+			}
+		}
+
+	private:
+		struct edge {
+			ruleset* before;
+			ruleset* after;
+		};
+
+		struct measured_ruleset {
+			const ruleset* target;
+			ruleset* begin;
+		};
+
+		class span_marker : public ruleset {
+		public:
+			span_marker(task_timeline& timeline, task_timeline::node n, bool begin)
+				: m_timeline(timeline), m_node(n), m_begin(begin), m_name(timeline.name(n) + (begin ? " begin" : " end")) {}
+
+			virtual void onFrameProcess(rynx::scheduler::context& context, float) override {
+				context.add_task(m_name, [this]() {
+					if (m_begin)
+						m_timeline.span_begin(m_node);
+					else
+						m_timeline.span_end(m_node);
+				});
+			}
+
+		private:
+			task_timeline& m_timeline;
+			task_timeline::node m_node;
+			bool m_begin;
+			std::string m_name;
+		};
+
+		std::vector<task_timeline::node> nodes_of(const ruleset* r) const {
+			std::vector<task_timeline::node> result;
+			for (task_timeline::node n = 0; n < m_timeline.size(); ++n)
+				if (m_timeline.owner(n) == r)
+					result.emplace_back(n);
+			return result;
+		}
+
+		task_timeline& m_timeline;
+		std::vector<edge> m_edges;
+		std::vector<measured_ruleset> m_measured;
+		std::vector<const ruleset*> m_unordered;
+	};
+}
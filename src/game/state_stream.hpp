@@ -0,0 +1,798 @@
+
+#pragma once
+
+#include <rynx/tech/ecs.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace game {
+
+	// recording of simulation state (not inputs) for replays and spectating.
+	// selected components are written as tracks of quantized float channels. every keyframe_interval ticks
+	// the whole tracked state is written, in between only entity creation / erasure runs and the channels
+	// that changed, as deltas against the previous tick. all state is kept quantized on both ends, so deltas
+	// never drift. a reader reconstructs any tick by decoding from the nearest keyframe before it.
+	namespace state_stream {
+
+		static constexpr uint32_t format_version = 1;
+		static constexpr size_t max_channels = 16;
+		static constexpr size_t max_entities = size_t(1) << 20; // per frame, far above anything the game spawns
+
+		enum frame_type : uint8_t {
+			keyframe = 0,
+			delta = 1
+		};
+
+		class byte_writer {
+		public:
+			void u8(uint8_t v) { bytes.push_back(v); }
+
+			void varint(uint64_t v) {
+				while (v >= 0x80) {
+					bytes.push_back(uint8_t(v) | 0x80);
+					v >>= 7;
+				}
+				bytes.push_back(uint8_t(v));
+			}
+
+			void svarint(int64_t v) { varint((uint64_t(v) << 1) ^ uint64_t(v >> 63)); }
+
+			void f32(float v) {
+				uint8_t raw[sizeof(float)];
+				std::memcpy(raw, &v, sizeof(float));
+				bytes.insert(bytes.end(), raw, raw + sizeof(float));
+			}
+
+			void str(const std::string& s) {
+				varint(s.size());
+				bytes.insert(bytes.end(), s.begin(), s.end());
+			}
+
+			void append(const byte_writer& other) { bytes.insert(bytes.end(), other.bytes.begin(), other.bytes.end()); }
+
+			std::vector<uint8_t> bytes;
+		};
+
+		class byte_reader {
+		public:
+			byte_reader(const uint8_t* data, size_t size) : m_p(data), m_end(data + size) {}
+
+			uint8_t u8() {
+				if (m_p >= m_end) { m_ok = false; return 0; }
+				return *m_p++;
+			}
+
+			uint64_t varint() {
+				uint64_t v = 0;
+				for (int shift = 0; shift < 64; shift += 7) {
+					uint8_t b = u8();
+					v |= uint64_t(b & 0x7f) << shift;
+					if (!(b & 0x80))
+						return v;
+				}
+				m_ok = false;
+				return 0;
+			}
+
+			int64_t svarint() {
+				uint64_t v = varint();
+				return int64_t(v >> 1) ^ -int64_t(v & 1);
+			}
+
+			float f32() {
+				float v = 0;
+				if (size_t(m_end - m_p) < sizeof(float)) { m_ok = false; return v; }
+				std::memcpy(&v, m_p, sizeof(float));
+				m_p += sizeof(float);
+				return v;
+			}
+
+			std::string str() {
+				size_t size = size_t(varint());
+				if (size > size_t(m_end - m_p)) { m_ok = false; return {}; }
+				std::string s(reinterpret_cast<const char*>(m_p), size);
+				m_p += size;
+				return s;
+			}
+
+			const uint8_t* position() const { return m_p; }
+			void skip(size_t size) { if (size > size_t(m_end - m_p)) { m_ok = false; m_p = m_end; } else { m_p += size; } }
+			bool ok() const { return m_ok; }
+			bool at_end() const { return m_p >= m_end; }
+			size_t remaining() const { return size_t(m_end - m_p); }
+
+		private:
+			const uint8_t* m_p;
+			const uint8_t* m_end;
+			bool m_ok = true;
+		};
+
+		struct track_info {
+			std::string name;
+			std::vector<float> quanta; // one per channel, value = quantized * quantum.
+		};
+
+		// quantized state of all tracked entities at one tick. entities are sorted by id.
+		struct frame_state {
+			struct track {
+				std::vector<uint8_t> present; // per entity
+				std::vector<int32_t> values; // per entity, channels consecutive
+			};
+
+			uint64_t tick = 0;
+			float time = 0; // simulated seconds since the recording started
+			std::vector<uint64_t> ids;
+			std::vector<track> tracks;
+
+			// index of an entity, or ids.size() when it does not exist at this tick.
+			size_t find(uint64_t id) const {
+				auto it = std::lower_bound(ids.begin(), ids.end(), id);
+				return (it != ids.end() && *it == id) ? size_t(it - ids.begin()) : ids.size();
+			}
+		};
+
+		inline int32_t quantize(float value, float quantum) {
+			double q = std::round(double(value) / double(quantum));
+			return int32_t(std::clamp(q, double(INT32_MIN), double(INT32_MAX)));
+		}
+
+		// consecutive ids are written as (gap, length) runs.
+		inline void write_id_runs(byte_writer& out, const std::vector<uint64_t>& sorted_ids) {
+			byte_writer runs;
+			size_t count = 0;
+			uint64_t previous_end = 0;
+			for (size_t i = 0; i < sorted_ids.size();) {
+				size_t j = i + 1;
+				while (j < sorted_ids.size() && sorted_ids[j] == sorted_ids[j - 1] + 1)
+					++j;
+				runs.varint(sorted_ids[i] - previous_end);
+				runs.varint(j - i);
+				previous_end = sorted_ids[j - 1] + 1;
+				++count;
+				i = j;
+			}
+			out.varint(count);
+			out.append(runs);
+		}
+
+		// fails on truncated input, on runs that overflow the id space and on more than max_entities ids,
+		// so a corrupt length can't make the reader allocate without bound.
+		inline bool read_id_runs(byte_reader& in, std::vector<uint64_t>& ids) {
+			ids.clear();
+			uint64_t runs = in.varint();
+			uint64_t previous_end = 0;
+			for (uint64_t r = 0; r < runs; ++r) {
+				uint64_t gap = in.varint();
+				uint64_t length = in.varint();
+				if (!in.ok() || length > max_entities - ids.size())
+					return false;
+				uint64_t start = previous_end + gap;
+				if (start < previous_end || start + length < start)
+					return false;
+				for (uint64_t k = 0; k < length; ++k)
+					ids.push_back(start + k);
+				previous_end = start + length;
+			}
+			return in.ok();
+		}
+
+		inline void encode_keyframe(byte_writer& out, const std::vector<track_info>& tracks, const frame_state& state) {
+			write_id_runs(out, state.ids);
+			for (size_t t = 0; t < tracks.size(); ++t) {
+				size_t channels = tracks[t].quanta.size();
+				const auto& track = state.tracks[t];
+				for (size_t i = 0; i < state.ids.size(); i += 8) {
+					uint8_t bits = 0;
+					for (size_t b = 0; b < 8 && i + b < state.ids.size(); ++b)
+						bits |= uint8_t(track.present[i + b] << b);
+					out.u8(bits);
+				}
+				for (size_t i = 0; i < state.ids.size(); ++i) {
+					if (!track.present[i])
+						continue;
+					for (size_t c = 0; c < channels; ++c)
+						out.svarint(track.values[i * channels + c]);
+				}
+			}
+		}
+
+		inline bool decode_keyframe(byte_reader& in, const std::vector<track_info>& tracks, frame_state& state) {
+			if (!read_id_runs(in, state.ids))
+				return false;
+
+			// every track stores a presence bit per entity, more ids than that are a corrupt frame.
+			if (!tracks.empty() && (state.ids.size() + 7) / 8 > in.remaining())
+				return false;
+
+			state.tracks.assign(tracks.size(), {});
+			for (size_t t = 0; t < tracks.size(); ++t) {
+				size_t channels = tracks[t].quanta.size();
+				if (channels > max_channels)
+					return false;
+				auto& track = state.tracks[t];
+				track.present.assign(state.ids.size(), 0);
+				track.values.assign(state.ids.size() * channels, 0);
+				for (size_t i = 0; i < state.ids.size(); i += 8) {
+					uint8_t bits = in.u8();
+					for (size_t b = 0; b < 8 && i + b < state.ids.size(); ++b)
+						track.present[i + b] = (bits >> b) & 1;
+				}
+				for (size_t i = 0; i < state.ids.size(); ++i) {
+					if (!track.present[i])
+						continue;
+					for (size_t c = 0; c < channels; ++c)
+						track.values[i * channels + c] = int32_t(in.svarint());
+				}
+			}
+			return in.ok();
+		}
+
+		// per track entries: entity index gap, then op. added entities carry all channels,
+		// changed ones a channel mask and deltas for the masked channels.
+		enum entry_op : uint8_t {
+			op_added = 0,
+			op_removed = 1,
+			op_changed = 2
+		};
+
+		// maps each entity of `current` to its index in `previous`, or previous.ids.size() for new entities.
+		inline void match_entities(const frame_state& previous, const frame_state& current, std::vector<size_t>& previous_index) {
+			previous_index.resize(current.ids.size());
+			size_t j = 0;
+			for (size_t i = 0; i < current.ids.size(); ++i) {
+				while (j < previous.ids.size() && previous.ids[j] < current.ids[i])
+					++j;
+				previous_index[i] = (j < previous.ids.size() && previous.ids[j] == current.ids[i]) ? j : previous.ids.size();
+			}
+		}
+
+		inline void encode_delta(byte_writer& out, const std::vector<track_info>& tracks, const frame_state& previous, const frame_state& current) {
+			std::vector<uint64_t> erased;
+			std::set_difference(previous.ids.begin(), previous.ids.end(), current.ids.begin(), current.ids.end(), std::back_inserter(erased));
+			std::vector<uint64_t> created;
+			std::set_difference(current.ids.begin(), current.ids.end(), previous.ids.begin(), previous.ids.end(), std::back_inserter(created));
+			write_id_runs(out, erased);
+			write_id_runs(out, created);
+
+			std::vector<size_t> previous_index;
+			match_entities(previous, current, previous_index);
+
+			for (size_t t = 0; t < tracks.size(); ++t) {
+				size_t channels = tracks[t].quanta.size();
+				const auto& cur = current.tracks[t];
+				const auto& prev = previous.tracks[t];
+
+				byte_writer entries;
+				size_t count = 0;
+				size_t last_index = 0;
+				auto begin_entry = [&](size_t index, entry_op op) {
+					entries.varint(index - last_index);
+					entries.u8(op);
+					last_index = index;
+					++count;
+				};
+
+				for (size_t i = 0; i < current.ids.size(); ++i) {
+					size_t j = previous_index[i];
+					bool was_present = j < previous.ids.size() && prev.present[j];
+					if (!cur.present[i]) {
+						if (was_present)
+							begin_entry(i, op_removed);
+						continue;
+					}
+
+					const int32_t* values = &cur.values[i * channels];
+					if (!was_present) {
+						begin_entry(i, op_added);
+						for (size_t c = 0; c < channels; ++c)
+							entries.svarint(values[c]);
+						continue;
+					}
+
+					const int32_t* old_values = &prev.values[j * channels];
+					uint32_t mask = 0;
+					for (size_t c = 0; c < channels; ++c)
+						mask |= uint32_t(values[c] != old_values[c]) << c;
+					if (mask == 0)
+						continue;
+
+					begin_entry(i, op_changed);
+					entries.varint(mask);
+					for (size_t c = 0; c < channels; ++c)
+						if (mask & (1u << c))
+							entries.svarint(int64_t(values[c]) - int64_t(old_values[c]));
+				}
+
+				out.varint(count);
+				out.append(entries);
+			}
+		}
+
+		inline bool decode_delta(byte_reader& in, const std::vector<track_info>& tracks, const frame_state& previous, frame_state& current) {
+			std::vector<uint64_t> erased;
+			std::vector<uint64_t> created;
+			if (!read_id_runs(in, erased) || !read_id_runs(in, created))
+				return false;
+
+			std::vector<uint64_t> survivors;
+			std::set_difference(previous.ids.begin(), previous.ids.end(), erased.begin(), erased.end(), std::back_inserter(survivors));
+			current.ids.clear();
+			std::merge(survivors.begin(), survivors.end(), created.begin(), created.end(), std::back_inserter(current.ids));
+
+			std::vector<size_t> previous_index;
+			match_entities(previous, current, previous_index);
+
+			if (current.ids.size() > max_entities)
+				return false;
+
+			current.tracks.assign(tracks.size(), {});
+			for (size_t t = 0; t < tracks.size(); ++t) {
+				size_t channels = tracks[t].quanta.size();
+				if (channels > max_channels)
+					return false;
+				const auto& prev = previous.tracks[t];
+				auto& cur = current.tracks[t];
+				cur.present.assign(current.ids.size(), 0);
+				cur.values.assign(current.ids.size() * channels, 0);
+				for (size_t i = 0; i < current.ids.size(); ++i) {
+					size_t j = previous_index[i];
+					if (j < previous.ids.size() && prev.present[j]) {
+						cur.present[i] = 1;
+						std::copy_n(&prev.values[j * channels], channels, &cur.values[i * channels]);
+					}
+				}
+
+				uint64_t count = in.varint();
+				size_t index = 0;
+				for (uint64_t e = 0; e < count && in.ok(); ++e) {
+					index += size_t(in.varint());
+					uint8_t op = in.u8();
+					if (index >= current.ids.size())
+						return false;
+
+					int32_t* values = &cur.values[index * channels];
+					if (op == op_removed) {
+						cur.present[index] = 0;
+					}
+					else if (op == op_added) {
+						cur.present[index] = 1;
+						for (size_t c = 0; c < channels; ++c)
+							values[c] = int32_t(in.svarint());
+					}
+					else {
+						uint64_t mask = in.varint();
+						for (size_t c = 0; c < channels; ++c)
+							if (mask & (1ull << c))
+								values[c] = int32_t(values[c] + in.svarint());
+					}
+				}
+			}
+			return in.ok();
+		}
+
+		// start of a stream, the tracks every frame after it is encoded against.
+		inline void encode_header(byte_writer& out, const std::vector<track_info>& tracks) {
+			out.u8('R'); out.u8('S'); out.u8('T'); out.u8('M');
+			out.varint(format_version);
+			out.varint(tracks.size());
+			for (const auto& track : tracks) {
+				out.str(track.name);
+				out.varint(track.quanta.size());
+				for (float q : track.quanta)
+					out.f32(q);
+			}
+		}
+
+		// one tick of the stream, payload is an encoded keyframe or delta.
+		inline void encode_frame(byte_writer& out, frame_type type, uint64_t tick, float time, const byte_writer& payload) {
+			out.u8(type);
+			out.varint(tick);
+			out.f32(time);
+			out.varint(payload.bytes.size());
+			out.append(payload);
+		}
+
+		// where the encoded stream goes. write either takes the whole frame or none of it,
+		// the writer follows a rejected frame with a keyframe so readers can resync.
+		class sink {
+		public:
+			virtual ~sink() {}
+			virtual bool write(const uint8_t* data, size_t size) = 0;
+		};
+
+		class file_sink : public sink {
+		public:
+			file_sink(const std::string& path) : m_file(path, std::ios::binary | std::ios::trunc) {}
+			bool is_open() const { return m_file.is_open(); }
+			bool write(const uint8_t* data, size_t size) override {
+				m_file.write(reinterpret_cast<const char*>(data), std::streamsize(size));
+				return bool(m_file);
+			}
+
+		private:
+			std::ofstream m_file;
+		};
+
+		// streams to a spectator listening on a local tcp port. the socket never blocks the caller:
+		// frames the spectator hasn't read yet wait in a bounded buffer, frames that don't fit are dropped.
+		class socket_sink : public sink {
+		public:
+			socket_sink(uint16_t port, size_t max_pending_bytes = 1024 * 1024) : m_max_pending(max_pending_bytes) {
+#if defined(__linux__) || defined(__APPLE__)
+				m_socket = ::socket(AF_INET, SOCK_STREAM, 0);
+				if (m_socket < 0)
+					return;
+
+#if defined(__APPLE__)
+				int no_sigpipe = 1;
+				::setsockopt(m_socket, SOL_SOCKET, SO_NOSIGPIPE, &no_sigpipe, sizeof(no_sigpipe));
+#endif
+
+				sockaddr_in address{};
+				address.sin_family = AF_INET;
+				address.sin_port = htons(port);
+				address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+				if (::connect(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+					::fcntl(m_socket, F_SETFL, ::fcntl(m_socket, F_GETFL, 0) | O_NONBLOCK) != 0)
+				{
+					::close(m_socket);
+					m_socket = -1;
+				}
+#else
+				(void)port;
+#endif
+			}
+
+			~socket_sink() {
+#if defined(__linux__) || defined(__APPLE__)
+				if (m_socket >= 0)
+					::close(m_socket);
+#endif
+			}
+
+			bool is_open() const { return m_socket >= 0; }
+			uint64_t dropped_frames() const { return m_dropped; }
+
+			bool write(const uint8_t* data, size_t size) override {
+				flush();
+				if (m_socket < 0)
+					return false;
+
+				// a frame larger than the whole buffer is still taken when nothing else is waiting, or it could never be sent.
+				if (!m_pending.empty() && m_pending.size() + size > m_max_pending) {
+					++m_dropped;
+					return false;
+				}
+
+				m_pending.insert(m_pending.end(), data, data + size);
+				flush();
+				return m_socket >= 0;
+			}
+
+		private:
+			// sends as much of the pending bytes as the socket takes right now.
+			void flush() {
+#if defined(__linux__) || defined(__APPLE__)
+#if defined(MSG_NOSIGNAL)
+				constexpr int flags = MSG_NOSIGNAL; // a closed spectator must not kill the game with SIGPIPE.
+#else
+				constexpr int flags = 0;
+#endif
+				size_t offset = 0;
+				while (m_socket >= 0 && offset < m_pending.size()) {
+					auto sent = ::send(m_socket, m_pending.data() + offset, m_pending.size() - offset, flags);
+					if (sent > 0) {
+						offset += size_t(sent);
+						continue;
+					}
+					if (sent < 0 && errno == EINTR)
+						continue;
+					if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+						break; // the spectator is behind, the rest goes out on a later frame.
+					::close(m_socket);
+					m_socket = -1;
+				}
+
+				if (m_socket < 0)
+					m_pending.clear();
+				else
+					m_pending.erase(m_pending.begin(), m_pending.begin() + std::ptrdiff_t(offset));
+#else
+				m_pending.clear();
+#endif
+			}
+
+			int m_socket = -1;
+			size_t m_max_pending;
+			std::vector<uint8_t> m_pending;
+			uint64_t m_dropped = 0;
+		};
+
+		class writer {
+		public:
+			writer(std::unique_ptr<sink> out, uint32_t keyframe_interval = 300) : m_sink(std::move(out)), m_keyframe_interval(std::max(1u, keyframe_interval)) {}
+
+			// read(const T&, float* channels) fills one float per quantum. tracks must be added before the first capture.
+			template<typename T, typename F>
+			void add_track(std::string name, std::vector<float> quanta, F read) {
+				rynx_assert(m_ticks == 0, "tracks must be added before recording starts");
+				rynx_assert(!quanta.empty() && quanta.size() <= max_channels, "bad channel count");
+				size_t channels = quanta.size();
+				m_tracks.push_back({ std::move(name), quanta });
+				m_collectors.emplace_back([read, quanta = std::move(quanta), channels](rynx::ecs& ecs, std::vector<uint64_t>& ids, std::vector<int32_t>& values) {
+					float channel_values[max_channels];
+					for (auto id : ecs.query().in<T>().ids()) {
+						read(ecs[id].template get<const T>(), channel_values);
+						ids.push_back(id.value);
+						for (size_t c = 0; c < channels; ++c)
+							values.push_back(quantize(channel_values[c], quanta[c]));
+					}
+				});
+			}
+
+			// main thread, while no tasks are running.
+			void capture(rynx::ecs& ecs, uint64_t tick, float dt) {
+				if (m_ticks == 0)
+					write_header();
+
+				m_time += dt;
+				collect(ecs, tick);
+
+				bool is_keyframe = m_force_keyframe || (m_ticks % m_keyframe_interval) == 0;
+				byte_writer payload;
+				if (is_keyframe)
+					encode_keyframe(payload, m_tracks, m_current);
+				else
+					encode_delta(payload, m_tracks, m_previous, m_current);
+
+				byte_writer frame;
+				encode_frame(frame, is_keyframe ? keyframe : delta, tick, m_time, payload);
+
+				// deltas after a frame the sink didn't take would apply to a state the reader never saw.
+				m_force_keyframe = !emit(frame);
+				if (!m_force_keyframe) {
+					(is_keyframe ? m_keyframe_bytes : m_delta_bytes) += frame.bytes.size();
+					m_keyframes += is_keyframe;
+				}
+				++m_ticks;
+				std::swap(m_previous, m_current);
+			}
+
+			uint64_t bytes_written() const { return m_header_bytes + m_keyframe_bytes + m_delta_bytes; }
+
+			float bytes_per_minute() const {
+				return m_time > 0 ? float(bytes_written()) * 60.0f / m_time : 0.0f;
+			}
+
+			std::string report() const {
+				char line[256];
+				std::snprintf(line, sizeof(line),
+					"state stream: %llu ticks (%llu keyframes), %.1fs recorded, %.1f KB total (%.1f KB keyframes, %.1f KB deltas), %.1f KB/min, %.1f kbit/s\n",
+					(unsigned long long)m_ticks, (unsigned long long)m_keyframes, m_time,
+					bytes_written() / 1024.0f, m_keyframe_bytes / 1024.0f, m_delta_bytes / 1024.0f,
+					bytes_per_minute() / 1024.0f, bytes_per_minute() * 8.0f / 60.0f / 1000.0f);
+				return line;
+			}
+
+		private:
+			void write_header() {
+				byte_writer header;
+				encode_header(header, m_tracks);
+				emit(header);
+				m_header_bytes = header.bytes.size();
+				m_previous = frame_state();
+				m_previous.tracks.assign(m_tracks.size(), {});
+			}
+
+			void collect(rynx::ecs& ecs, uint64_t tick) {
+				m_current.tick = tick;
+				m_current.time = m_time;
+				m_current.ids.clear();
+
+				m_collected_ids.resize(m_tracks.size());
+				m_collected_values.resize(m_tracks.size());
+				for (size_t t = 0; t < m_tracks.size(); ++t) {
+					m_collected_ids[t].clear();
+					m_collected_values[t].clear();
+					m_collectors[t](ecs, m_collected_ids[t], m_collected_values[t]);
+					m_current.ids.insert(m_current.ids.end(), m_collected_ids[t].begin(), m_collected_ids[t].end());
+				}
+
+				std::sort(m_current.ids.begin(), m_current.ids.end());
+				m_current.ids.erase(std::unique(m_current.ids.begin(), m_current.ids.end()), m_current.ids.end());
+
+				m_current.tracks.resize(m_tracks.size());
+				for (size_t t = 0; t < m_tracks.size(); ++t) {
+					size_t channels = m_tracks[t].quanta.size();
+					auto& track = m_current.tracks[t];
+					track.present.assign(m_current.ids.size(), 0);
+					track.values.assign(m_current.ids.size() * channels, 0);
+					const auto& ids = m_collected_ids[t];
+					for (size_t k = 0; k < ids.size(); ++k) {
+						size_t i = m_current.find(ids[k]);
+						track.present[i] = 1;
+						std::copy_n(&m_collected_values[t][k * channels], channels, &track.values[i * channels]);
+					}
+				}
+			}
+
+			bool emit(const byte_writer& bytes) {
+				return m_sink && m_sink->write(bytes.bytes.data(), bytes.bytes.size());
+			}
+
+			std::unique_ptr<sink> m_sink;
+			uint32_t m_keyframe_interval;
+			std::vector<track_info> m_tracks;
+			std::vector<std::function<void(rynx::ecs&, std::vector<uint64_t>&, std::vector<int32_t>&)>> m_collectors;
+
+			frame_state m_previous;
+			frame_state m_current;
+			std::vector<std::vector<uint64_t>> m_collected_ids;
+			std::vector<std::vector<int32_t>> m_collected_values;
+
+			uint64_t m_ticks = 0;
+			uint64_t m_keyframes = 0;
+			uint64_t m_header_bytes = 0;
+			uint64_t m_keyframe_bytes = 0;
+			uint64_t m_delta_bytes = 0;
+			float m_time = 0;
+			bool m_force_keyframe = false;
+		};
+
+		// random access reader for recorded streams.
+		class reader {
+		public:
+			bool open(const std::string& path) {
+				std::ifstream file(path, std::ios::binary);
+				if (!file)
+					return false;
+				m_data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+				return index();
+			}
+
+			const std::vector<track_info>& tracks() const { return m_tracks; }
+			size_t frame_count() const { return m_frames.size(); }
+			size_t keyframe_count() const { return m_keyframes.size(); }
+			size_t size_bytes() const { return m_data.size(); }
+			uint64_t first_tick() const { return m_frames.empty() ? 0 : m_frames.front().tick; }
+			uint64_t last_tick() const { return m_frames.empty() ? 0 : m_frames.back().tick; }
+			float duration() const { return m_frames.empty() ? 0.0f : m_frames.back().time; }
+
+			// reconstructs the last recorded state at or before tick.
+			bool seek(uint64_t tick) {
+				auto after = std::upper_bound(m_frames.begin(), m_frames.end(), tick, [](uint64_t t, const frame_entry& f) { return t < f.tick; });
+				if (after == m_frames.begin())
+					return false;
+				size_t target = size_t(after - m_frames.begin()) - 1;
+
+				auto key_after = std::upper_bound(m_keyframes.begin(), m_keyframes.end(), target);
+				if (key_after == m_keyframes.begin())
+					return false;
+				size_t key = *(key_after - 1);
+
+				// keep decoding forward from where we are when no keyframe is in between.
+				size_t next = key;
+				if (m_decoded_frame != invalid && m_decoded_frame >= key && m_decoded_frame <= target)
+					next = m_decoded_frame + 1;
+
+				for (size_t f = next; f <= target; ++f) {
+					if (!decode(f))
+						return false;
+				}
+				return true;
+			}
+
+			const frame_state& state() const { return m_state; }
+
+			// dequantized value of a channel, entity_index indexes state().ids.
+			float value(size_t track, size_t entity_index, size_t channel) const {
+				size_t channels = m_tracks[track].quanta.size();
+				return m_state.tracks[track].values[entity_index * channels + channel] * m_tracks[track].quanta[channel];
+			}
+
+			bool has(size_t track, size_t entity_index) const {
+				return m_state.tracks[track].present[entity_index] != 0;
+			}
+
+		private:
+			static constexpr size_t invalid = ~size_t(0);
+
+			struct frame_entry {
+				uint8_t type;
+				uint64_t tick;
+				float time;
+				size_t offset;
+				size_t size;
+			};
+
+			bool index() {
+				m_frames.clear();
+				m_keyframes.clear();
+				m_tracks.clear();
+				m_decoded_frame = invalid;
+
+				byte_reader in(m_data.data(), m_data.size());
+				if (in.u8() != 'R' || in.u8() != 'S' || in.u8() != 'T' || in.u8() != 'M')
+					return false;
+				if (in.varint() != format_version)
+					return false;
+
+				uint64_t num_tracks = in.varint();
+				for (uint64_t t = 0; t < num_tracks && in.ok(); ++t) {
+					track_info track;
+					track.name = in.str();
+					uint64_t channels = in.varint();
+					if (channels == 0 || channels > max_channels)
+						return false;
+					for (uint64_t c = 0; c < channels; ++c)
+						track.quanta.push_back(in.f32());
+					m_tracks.emplace_back(std::move(track));
+				}
+
+				while (in.ok() && !in.at_end()) {
+					frame_entry frame;
+					frame.type = in.u8();
+					frame.tick = in.varint();
+					frame.time = in.f32();
+					frame.size = size_t(in.varint());
+					frame.offset = size_t(in.position() - m_data.data());
+					in.skip(frame.size);
+					if (!in.ok())
+						break; // truncated last frame, for example a recording that is still being written.
+
+					if (frame.type == keyframe)
+						m_keyframes.push_back(m_frames.size());
+					m_frames.push_back(frame);
+				}
+				return !m_tracks.empty() || !m_frames.empty();
+			}
+
+			bool decode(size_t f) {
+				const auto& frame = m_frames[f];
+				byte_reader in(m_data.data() + frame.offset, frame.size);
+				bool ok;
+				if (frame.type == keyframe) {
+					ok = decode_keyframe(in, m_tracks, m_state);
+				}
+				else {
+					if (m_decoded_frame + 1 != f)
+						return false;
+					frame_state next;
+					ok = decode_delta(in, m_tracks, m_state, next);
+					m_state = std::move(next);
+				}
+
+				m_state.tick = frame.tick;
+				m_state.time = frame.time;
+				m_decoded_frame = ok ? f : invalid;
+				return ok;
+			}
+
+			std::vector<uint8_t> m_data;
+			std::vector<track_info> m_tracks;
+			std::vector<frame_entry> m_frames;
+			std::vector<size_t> m_keyframes; // indices into m_frames
+			frame_state m_state;
+			size_t m_decoded_frame = invalid;
+		};
+	}
+}
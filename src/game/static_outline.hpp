@@ -0,0 +1,64 @@
+
+#pragma once
+
+#include <rynx/tech/components.hpp>
+#include <rynx/tech/ecs.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace game {
+
+	// closed outline of the static terrain in world space, for the game systems that test bodies against
+	// the terrain themselves. set by the level, read by tasks.
+	class static_outline {
+	public:
+		struct segment {
+			float ax, ay, bx, by;
+		};
+
+		void set(rynx::ecs::id terrain, uint64_t category, const std::vector<rynx::vec3f>& points) {
+			m_terrain = terrain;
+			m_category = category;
+			m_segments.clear();
+			for (size_t i = 0; i < points.size(); ++i) {
+				const auto& a = points[i];
+				const auto& b = points[(i + 1) % points.size()];
+				m_segments.push_back({ a.x, a.y, b.x, b.y });
+			}
+		}
+
+		void clear() { m_segments.clear(); }
+
+		// segments whose bounding box overlaps the given box.
+		template<typename F>
+		void for_each_near(float min_x, float min_y, float max_x, float max_y, F&& op) const {
+			for (const auto& s : m_segments) {
+				if (std::max(s.ax, s.bx) < min_x || std::min(s.ax, s.bx) > max_x || std::max(s.ay, s.by) < min_y || std::min(s.ay, s.by) > max_y)
+					continue;
+				op(s);
+			}
+		}
+
+		// closest point of a segment to (px, py).
+		static void closest_point(const segment& s, float px, float py, float& qx, float& qy) {
+			float ex = s.bx - s.ax;
+			float ey = s.by - s.ay;
+			float length_sqr = ex * ex + ey * ey;
+			float u = length_sqr > 0.0f ? std::clamp(((px - s.ax) * ex + (py - s.ay) * ey) / length_sqr, 0.0f, 1.0f) : 0.0f;
+			qx = s.ax + ex * u;
+			qy = s.ay + ey * u;
+		}
+
+		rynx::ecs::id terrain() const { return m_terrain; }
+		uint64_t category() const { return m_category; }
+		bool empty() const { return m_segments.empty(); }
+
+	private:
+		rynx::ecs::id m_terrain;
+		uint64_t m_category = 0;
+		std::vector<segment> m_segments;
+	};
+}
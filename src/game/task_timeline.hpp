@@ -0,0 +1,421 @@
+
+#pragma once
+
+#include <rynx/tech/ecs.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace game {
+
+	// records when and on which thread the instrumented frame tasks ran, and explains the frame afterwards:
+	// which chain of declared dependencies bounded it, how much slack the other tasks had, how much parallelism
+	// was achieved and how long each thread sat idle. tasks and edges are declared during setup, results are
+	// averaged over frames until reset_summary().
+	// only instrumented tasks are seen. engine rulesets can only be timed as a span from outside (see ruleset_graph::measure),
+	// which threads ran their tasks is unknown, so that work counts as idle in the thread stats.
+	class task_timeline {
+	public:
+		using clock = std::chrono::steady_clock;
+		using node = uint32_t;
+
+		// declaring the same name twice returns the same node.
+		// owner is whatever adds the task to the scheduler, usually a ruleset. see ruleset_graph.
+		node declare(std::string_view name, const void* owner = nullptr) {
+			for (node n = 0; n < m_nodes.size(); ++n)
+				if (m_nodes[n].name == name)
+					return n;
+
+			m_nodes.emplace_back();
+			m_nodes.back().name = std::string(name);
+			m_nodes.back().owner = owner;
+			m_order_dirty = true;
+			return node(m_nodes.size() - 1);
+		}
+
+		node size() const {
+			return node(m_nodes.size());
+		}
+
+		const std::string& name(node n) const {
+			return m_nodes[n].name;
+		}
+
+		// a span around tasks that can't be instrumented themselves, recorded with span_begin and span_end.
+		// the span is wall time and counts towards the critical path, but not towards parallelism or thread busy time.
+		node declare_span(std::string_view name, const void* owner = nullptr) {
+			node n = declare(name, owner);
+			m_nodes[n].span = true;
+			return n;
+		}
+
+		const void* owner(node n) const {
+			return m_nodes[n].owner;
+		}
+
+		void depends_on(node after, node before) {
+			m_nodes[after].predecessors.emplace_back(before);
+			m_nodes[before].successors.emplace_back(after);
+			m_order_dirty = true;
+		}
+
+		void depends_on(std::string_view after, std::string_view before) {
+			depends_on(declare(after), declare(before));
+		}
+
+		class scope {
+		public:
+			scope(task_timeline& timeline, node n) : m_timeline(timeline), m_node(n), m_start(clock::now()) {}
+			~scope() { m_timeline.finish(m_node, m_start, clock::now()); }
+
+			scope(const scope&) = delete;
+			scope& operator = (const scope&) = delete;
+
+		private:
+			task_timeline& m_timeline;
+			node m_node;
+			clock::time_point m_start;
+		};
+
+		// call at the start of the task body. each node may run at most once per frame.
+		scope record(node n) {
+			return scope(*this, n);
+		}
+
+		// span_end must come from a task that runs after the one calling span_begin.
+		void span_begin(node n) {
+			m_nodes[n].start = clock::now();
+		}
+
+		void span_end(node n) {
+			finish(n, m_nodes[n].start, clock::now());
+		}
+
+		// main thread only, right before the scheduler starts the frame.
+		void begin_frame() {
+			for (auto& n : m_nodes)
+				n.ran = false;
+			m_frame_begin = clock::now();
+		}
+
+		// main thread only, after the scheduler has completed the frame.
+		void end_frame() {
+			auto frame_end = clock::now();
+			if (m_order_dirty)
+				rebuild_order();
+
+			double span = ms(m_frame_begin, frame_end);
+			double work = 0;
+			std::vector<double> thread_busy;
+
+			// forward pass: the predecessor that finished last is the one a task was waiting for.
+			node last = invalid;
+			for (node n : m_order) {
+				auto& s = m_nodes[n];
+				if (!s.ran)
+					continue;
+
+				s.critical_predecessor = invalid;
+				for (node p : s.predecessors) {
+					if (m_nodes[p].ran && (s.critical_predecessor == invalid || m_nodes[p].end > m_nodes[s.critical_predecessor].end))
+						s.critical_predecessor = p;
+				}
+
+				if (last == invalid || s.end > m_nodes[last].end)
+					last = n;
+
+				if (s.span)
+					continue;
+
+				double duration = ms(s.start, s.end);
+				work += duration;
+				if (thread_busy.size() <= s.thread)
+					thread_busy.resize(s.thread + 1, 0.0);
+				thread_busy[s.thread] += duration;
+			}
+
+			// backward pass: latest a task could have finished without making the frame any longer.
+			for (auto it = m_order.rbegin(); it != m_order.rend(); ++it) {
+				auto& s = m_nodes[*it];
+				if (!s.ran)
+					continue;
+
+				s.latest_end = span;
+				for (node succ : s.successors) {
+					const auto& next = m_nodes[succ];
+					if (next.ran)
+						s.latest_end = std::min(s.latest_end, next.latest_end - ms(next.start, next.end));
+				}
+
+				auto& acc = s.accumulated;
+				++acc.runs;
+				acc.duration += ms(s.start, s.end);
+				acc.slack += std::max(0.0, s.latest_end - ms(m_frame_begin, s.end));
+			}
+
+			m_last_critical_path.clear();
+			for (node n = last; n != invalid; n = m_nodes[n].critical_predecessor) {
+				++m_nodes[n].accumulated.on_critical_path;
+				m_last_critical_path.emplace_back(n);
+			}
+			std::reverse(m_last_critical_path.begin(), m_last_critical_path.end());
+
+			if (m_thread_busy.size() < thread_busy.size())
+				m_thread_busy.resize(thread_busy.size(), 0.0);
+			for (size_t i = 0; i < thread_busy.size(); ++i)
+				m_thread_busy[i] += thread_busy[i];
+
+			++m_frames;
+			m_span += span;
+			m_work += work;
+		}
+
+		struct task_stats {
+			std::string name;
+			uint64_t runs = 0;
+			double avg_duration_ms = 0;
+			double avg_slack_ms = 0;
+			float critical_path_ratio = 0; // fraction of frames the task was on the critical path.
+			bool span = false; // declared with declare_span.
+		};
+
+		struct thread_stats {
+			uint32_t thread = 0;
+			double busy_ms = 0;
+			float idle_percent = 0;
+		};
+
+		struct summary_t {
+			uint64_t frames = 0;
+			double avg_frame_ms = 0;
+			float parallelism = 0; // instrumented task time per frame time, spans excluded.
+			std::vector<task_stats> tasks;
+			std::vector<thread_stats> threads;
+			std::vector<std::string> last_critical_path;
+		};
+
+		uint64_t frames() const {
+			return m_frames;
+		}
+
+		summary_t summary() const {
+			summary_t result;
+			result.frames = m_frames;
+			if (m_frames == 0)
+				return result;
+
+			result.avg_frame_ms = m_span / m_frames;
+			result.parallelism = m_span > 0 ? float(m_work / m_span) : 0.0f;
+
+			for (const auto& s : m_nodes) {
+				task_stats t;
+				t.name = s.name;
+				t.runs = s.accumulated.runs;
+				if (t.runs > 0) {
+					t.avg_duration_ms = s.accumulated.duration / t.runs;
+					t.avg_slack_ms = s.accumulated.slack / t.runs;
+				}
+				t.critical_path_ratio = float(s.accumulated.on_critical_path) / m_frames;
+				t.span = s.span;
+				result.tasks.emplace_back(std::move(t));
+			}
+
+			// every thread that has recorded a task is listed, also ones that sat fully idle since the last reset.
+			uint32_t threads = std::max(uint32_t(m_thread_busy.size()), thread_counter().load());
+			for (uint32_t i = 0; i < threads; ++i) {
+				double busy_ms = i < m_thread_busy.size() ? m_thread_busy[i] : 0.0;
+				float busy = m_span > 0 ? float(busy_ms / m_span) : 0.0f;
+				result.threads.push_back({ i, busy_ms / m_frames, 100.0f * std::max(0.0f, 1.0f - busy) });
+			}
+
+			for (node n : m_last_critical_path)
+				result.last_critical_path.emplace_back(m_nodes[n].name);
+			return result;
+		}
+
+		void reset_summary() {
+			for (auto& n : m_nodes)
+				n.accumulated = {};
+			m_thread_busy.clear();
+			m_frames = 0;
+			m_span = 0;
+			m_work = 0;
+		}
+
+		std::string report_text() const {
+			auto s = summary();
+			std::string out;
+			char line[256];
+
+			std::snprintf(line, sizeof(line), "task timeline: %llu frames, %.3fms/frame, parallelism %.2f\n", (unsigned long long)s.frames, s.avg_frame_ms, s.parallelism);
+			out += line;
+
+			bool has_spans = std::any_of(s.tasks.begin(), s.tasks.end(), [](const task_stats& t) { return t.span; });
+			out += has_spans
+				? "only game tasks are timed per thread. [span] rows are engine rulesets timed from outside, their work counts as idle below.\n"
+				: "only game tasks are timed. time spent in engine tasks counts as idle below.\n";
+
+			out += "critical path:";
+			for (const auto& name : s.last_critical_path) {
+				out += (&name == &s.last_critical_path.front()) ? " " : " -> ";
+				out += name;
+			}
+			out += "\n";
+
+			for (const auto& t : s.tasks) {
+				std::snprintf(line, sizeof(line), "  %-40s %8.3fms  slack %8.3fms  critical %5.1f%%%s\n", t.name.c_str(), t.avg_duration_ms, t.avg_slack_ms, t.critical_path_ratio * 100.0f, t.span ? "  [span]" : "");
+				out += line;
+			}
+
+			for (const auto& t : s.threads) {
+				std::snprintf(line, sizeof(line), "  thread %2u busy %8.3fms/frame  idle %5.1f%%\n", t.thread, t.busy_ms, t.idle_percent);
+				out += line;
+			}
+			return out;
+		}
+
+		std::string report_json() const {
+			auto s = summary();
+			std::string out;
+			char number[64];
+			auto append_number = [&](double v) { std::snprintf(number, sizeof(number), "%.4f", v); out += number; };
+			auto append_string = [&](const std::string& v) {
+				out += '"';
+				for (char c : v) {
+					if (c == '"' || c == '\\')
+						out += '\\';
+					out += c;
+				}
+				out += '"';
+			};
+
+			out += "{\"frames\":" + std::to_string(s.frames) + ",\"avg_frame_ms\":";
+			append_number(s.avg_frame_ms);
+			out += ",\"parallelism\":";
+			append_number(s.parallelism);
+
+			out += ",\"critical_path\":[";
+			for (size_t i = 0; i < s.last_critical_path.size(); ++i) {
+				if (i) out += ',';
+				append_string(s.last_critical_path[i]);
+			}
+
+			out += "],\"tasks\":[";
+			for (size_t i = 0; i < s.tasks.size(); ++i) {
+				const auto& t = s.tasks[i];
+				if (i) out += ',';
+				out += "{\"name\":";
+				append_string(t.name);
+				out += ",\"runs\":" + std::to_string(t.runs) + ",\"avg_duration_ms\":";
+				append_number(t.avg_duration_ms);
+				out += ",\"avg_slack_ms\":";
+				append_number(t.avg_slack_ms);
+				out += ",\"critical_path_ratio\":";
+				append_number(t.critical_path_ratio);
+				out += t.span ? ",\"span\":true}" : ",\"span\":false}";
+			}
+
+			out += "],\"threads\":[";
+			for (size_t i = 0; i < s.threads.size(); ++i) {
+				const auto& t = s.threads[i];
+				if (i) out += ',';
+				out += "{\"thread\":" + std::to_string(t.thread) + ",\"busy_ms\":";
+				append_number(t.busy_ms);
+				out += ",\"idle_percent\":";
+				append_number(t.idle_percent);
+				out += '}';
+			}
+			out += "]}\n";
+			return out;
+		}
+
+	private:
+		static constexpr node invalid = std::numeric_limits<node>::max();
+
+		struct node_state {
+			std::string name;
+			const void* owner = nullptr;
+			bool span = false;
+			std::vector<node> predecessors;
+			std::vector<node> successors;
+
+			// written by the thread running the task, read by the main thread after the frame.
+			clock::time_point start;
+			clock::time_point end;
+			uint32_t thread = 0;
+			bool ran = false;
+
+			node critical_predecessor = invalid;
+			double latest_end = 0;
+
+			struct {
+				uint64_t runs = 0;
+				uint64_t on_critical_path = 0;
+				double duration = 0;
+				double slack = 0;
+			} accumulated;
+		};
+
+		static double ms(clock::time_point a, clock::time_point b) {
+			return std::chrono::duration<double, std::milli>(b - a).count();
+		}
+
+		static std::atomic<uint32_t>& thread_counter() {
+			static std::atomic<uint32_t> next = 0;
+			return next;
+		}
+
+		static uint32_t thread_index() {
+			thread_local uint32_t index = thread_counter().fetch_add(1);
+			return index;
+		}
+
+		void finish(node n, clock::time_point start, clock::time_point end) {
+			auto& s = m_nodes[n];
+			rynx_assert(!s.ran, "task recorded twice in one frame");
+			s.start = start;
+			s.end = end;
+			s.thread = thread_index();
+			s.ran = true;
+		}
+
+		// topological order of the declared nodes.
+		void rebuild_order() {
+			std::vector<uint32_t> incoming(m_nodes.size(), 0);
+			for (const auto& n : m_nodes)
+				for (node succ : n.successors)
+					++incoming[succ];
+
+			m_order.clear();
+			for (node n = 0; n < m_nodes.size(); ++n)
+				if (incoming[n] == 0)
+					m_order.emplace_back(n);
+
+			for (size_t i = 0; i < m_order.size(); ++i)
+				for (node succ : m_nodes[m_order[i]].successors)
+					if (--incoming[succ] == 0)
+						m_order.emplace_back(succ);
+
+			rynx_assert(m_order.size() == m_nodes.size(), "task timeline dependencies form a cycle");
+			m_order_dirty = false;
+		}
+
+		std::vector<node_state> m_nodes;
+		std::vector<node> m_order;
+		std::vector<node> m_last_critical_path;
+		bool m_order_dirty = false;
+
+		clock::time_point m_frame_begin;
+		std::vector<double> m_thread_busy;
+		uint64_t m_frames = 0;
+		double m_span = 0;
+		double m_work = 0;
+	};
+}
@@ -0,0 +1,108 @@
+
+#pragma once
+
+#include <rynx/tech/components.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace game {
+
+	// what the game camera sees, as a rectangle on the z = 0 plane the game is played on.
+	// a disabled view (headless worlds) sees everything.
+	struct lod_view {
+		bool enabled = false;
+		rynx::vec3f center;
+		float half_width = 0;
+		float half_height = 0;
+		float pixels_per_unit = 0; // screen pixels per world unit on the play plane
+
+		// the part of the z = 0 plane inside the camera's view frustum, given by the camera's basis and the
+		// tangents of its half field of view, 1 / projection[0][0] and 1 / projection[1][1] for a perspective
+		// projection. a tilted camera sees a trapezoid, the view is its bounding rectangle. a camera that
+		// sees past the horizon sees everything.
+		static lod_view from_frustum(rynx::vec3f position, rynx::vec3f forward, rynx::vec3f left, float tan_half_width, float tan_half_height, float viewport_height) {
+			rynx::vec3f up(
+				forward.y * left.z - forward.z * left.y,
+				forward.z * left.x - forward.x * left.z,
+				forward.x * left.y - forward.y * left.x);
+
+			lod_view view;
+			float min_x = std::numeric_limits<float>::max(), max_x = -min_x;
+			float min_y = min_x, max_y = -min_x;
+			for (float sx : { -1.0f, 1.0f }) {
+				for (float sy : { -1.0f, 1.0f }) {
+					rynx::vec3f ray = forward + left * (sx * tan_half_width) + up * (sy * tan_half_height);
+					if (ray.z * position.z >= 0.0f)
+						return view; // the corner ray never reaches the plane.
+
+					float t = -position.z / ray.z;
+					min_x = std::min(min_x, position.x + ray.x * t);
+					max_x = std::max(max_x, position.x + ray.x * t);
+					min_y = std::min(min_y, position.y + ray.y * t);
+					max_y = std::max(max_y, position.y + ray.y * t);
+				}
+			}
+
+			// scale where the view axis meets the plane, along the axis the world is tan * distance units per half screen.
+			float axis_distance = forward.z * position.z < 0.0f ? -position.z / forward.z * forward.length() : std::abs(position.z);
+			view.enabled = true;
+			view.center = rynx::vec3f((min_x + max_x) * 0.5f, (min_y + max_y) * 0.5f, 0.0f);
+			view.half_width = (max_x - min_x) * 0.5f;
+			view.half_height = (max_y - min_y) * 0.5f;
+			view.pixels_per_unit = viewport_height * 0.5f / std::max(axis_distance * tan_half_height, 1e-3f);
+			return view;
+		}
+
+		bool visible(rynx::vec3f p, float radius) const {
+			return !enabled || (
+				std::abs(p.x - center.x) <= half_width + radius &&
+				std::abs(p.y - center.y) <= half_height + radius);
+		}
+
+		float distance(rynx::vec3f p) const {
+			float dx = p.x - center.x;
+			float dy = p.y - center.y;
+			return std::sqrt(dx * dx + dy * dy);
+		}
+	};
+
+	// how often things that don't affect gameplay are updated depending on where they are relative to the view.
+	// each system that degrades its updates owns a policy, and only applies it to entities without gameplay
+	// relevant components (anything with health always updates at full rate).
+	struct lod_policy {
+		bool enabled = true;
+		float near_distance = 250.0f; // visible and closer than this updates every tick
+		uint32_t far_interval = 4; // visible but farther updates every Nth tick
+		uint32_t offscreen_interval = 16;
+		bool expire_offscreen = true; // short lived things that will end their life off screen are removed right away
+
+		enum class level {
+			near,
+			far,
+			offscreen
+		};
+
+		level classify(const lod_view& view, rynx::vec3f p, float radius) const {
+			if (!enabled || !view.enabled)
+				return level::near;
+			if (!view.visible(p, radius))
+				return level::offscreen;
+			return view.distance(p) > near_distance ? level::far : level::near;
+		}
+
+		// ticks between updates of an entity at this level.
+		uint32_t interval(level l) const {
+			return std::max(1u, l == level::near ? 1u : (l == level::far ? far_interval : offscreen_interval));
+		}
+
+		// whether an entity at this level gets its update on this tick. entities are spread over the
+		// ticks of an interval by id, so the work per tick stays even.
+		bool due(level l, uint64_t id, uint64_t tick) const {
+			uint32_t n = interval(l);
+			return n <= 1 || (id + tick) % n == 0;
+		}
+	};
+}
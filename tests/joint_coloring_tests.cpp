@@ -0,0 +1,90 @@
+
+#include <catch.hpp>
+
+#include "joint_solver.hpp"
+
+#include <map>
+#include <random>
+#include <set>
+#include <utility>
+
+using game::joint_coloring;
+
+TEST_CASE("joint coloring never gives two joints of a body the same color", "[joint_coloring]") {
+	joint_coloring coloring;
+	std::mt19937 rng(5);
+	std::map<uint64_t, std::pair<uint64_t, uint64_t>> joints;
+	std::map<uint64_t, uint32_t> previous_colors;
+
+	for (uint64_t frame = 1; frame < 300; ++frame) {
+		// joints come and go and some get reattached to other bodies.
+		std::set<uint64_t> changed;
+		for (int k = 0; k < 8; ++k) {
+			uint64_t joint = rng() % 400;
+			changed.insert(joint);
+			if (rng() % 3 == 0) {
+				joints.erase(joint);
+			}
+			else {
+				uint64_t a = rng() % 50;
+				uint64_t b = rng() % 50;
+				if (a != b)
+					joints[joint] = { a, b };
+			}
+		}
+
+		std::map<uint64_t, std::set<uint32_t>> body_colors;
+		std::map<uint64_t, uint32_t> colors;
+		for (const auto& [joint, bodies] : joints) {
+			uint32_t color = coloring.assign(joint, bodies.first, bodies.second, frame);
+			colors[joint] = color;
+
+			// joints that were left alone keep their color.
+			auto previous = previous_colors.find(joint);
+			if (previous != previous_colors.end() && !changed.count(joint))
+				REQUIRE(color == previous->second);
+
+			if (color == joint_coloring::serial_color)
+				continue;
+			REQUIRE(color < joint_coloring::serial_color);
+			REQUIRE(body_colors[bodies.first].insert(color).second);
+			REQUIRE(body_colors[bodies.second].insert(color).second);
+		}
+		coloring.remove_unseen(frame);
+		previous_colors = std::move(colors);
+	}
+}
+
+TEST_CASE("joint coloring falls back to the serial color", "[joint_coloring]") {
+	joint_coloring coloring;
+
+	// a hub body with more joints than there are parallel colors.
+	for (uint64_t joint = 0; joint < joint_coloring::serial_color; ++joint)
+		REQUIRE(coloring.assign(joint, 0, joint + 1, 1) == joint);
+	REQUIRE(coloring.assign(100, 0, 1000, 1) == joint_coloring::serial_color);
+	REQUIRE(coloring.assign(101, 0, 1001, 1) == joint_coloring::serial_color);
+
+	// other bodies are not affected.
+	REQUIRE(coloring.assign(102, 2000, 2001, 1) == 0);
+}
+
+TEST_CASE("joint coloring frees the colors of removed joints", "[joint_coloring]") {
+	joint_coloring coloring;
+	REQUIRE(coloring.assign(1, 10, 11, 1) == 0);
+	REQUIRE(coloring.assign(2, 10, 12, 1) == 1);
+	REQUIRE(coloring.assign(3, 10, 13, 1) == 2);
+	coloring.remove_unseen(1);
+
+	// joint 1 is gone on frame 2, its color is free for new joints of body 10.
+	REQUIRE(coloring.assign(2, 10, 12, 2) == 1);
+	REQUIRE(coloring.assign(3, 10, 13, 2) == 2);
+	coloring.remove_unseen(2);
+	REQUIRE(coloring.assign(4, 10, 14, 3) == 0);
+
+	// moving a joint to other bodies recolors it.
+	REQUIRE(coloring.assign(3, 20, 21, 3) == 0);
+	REQUIRE(coloring.assign(5, 10, 15, 3) == 2);
+
+	coloring.clear();
+	REQUIRE(coloring.assign(6, 10, 16, 4) == 0);
+}
@@ -0,0 +1,57 @@
+
+#include <catch.hpp>
+
+#include "mesh_lod.hpp"
+
+#include <cmath>
+
+TEST_CASE("mesh lod chain with one level always selects it", "[mesh_lod]") {
+	game::mesh_lod_chain chain;
+	chain.add(nullptr, 10.0f);
+	REQUIRE(chain.select(0.0f) == 0);
+	REQUIRE(chain.select(10.0f) == 0);
+	REQUIRE(chain.select(1000.0f) == 0);
+}
+
+TEST_CASE("mesh lod chain selects the coarsest level that is good enough", "[mesh_lod]") {
+	game::mesh_lod_chain chain;
+	chain.add(nullptr, 40.0f).add(nullptr, 5.0f).add(nullptr, 15.0f);
+
+	// levels are kept from coarsest to finest no matter the order they were added in.
+	REQUIRE(chain.levels().size() == 3);
+	REQUIRE(chain.levels()[0].max_screen_radius == 5.0f);
+	REQUIRE(chain.levels()[1].max_screen_radius == 15.0f);
+	REQUIRE(chain.levels()[2].max_screen_radius == 40.0f);
+
+	REQUIRE(chain.select(0.0f) == 0);
+	REQUIRE(chain.select(5.0f) == 0);
+	REQUIRE(chain.select(5.5f) == 1);
+	REQUIRE(chain.select(15.0f) == 1);
+	REQUIRE(chain.select(30.0f) == 2);
+
+	// anything larger than every level still gets the finest one.
+	REQUIRE(chain.select(40.0f) == 2);
+	REQUIRE(chain.select(1e6f) == 2);
+}
+
+TEST_CASE("mesh lod chain circles stay within the allowed error", "[mesh_lod]") {
+	game::mesh_lod_chain chain;
+	for (int segments : { 32, 16, 8, 4 })
+		chain.add_circle(nullptr, segments, 0.5f);
+
+	// more segments are good up to larger circles.
+	const auto& levels = chain.levels();
+	REQUIRE(levels.size() == 4);
+	for (size_t i = 1; i < levels.size(); ++i)
+		REQUIRE(levels[i - 1].max_screen_radius < levels[i].max_screen_radius);
+
+	// a circle of n segments is off by r * (1 - cos(pi / n)) pixels, check it at the edge of every level.
+	int segments_of_level[] = { 4, 8, 16 };
+	for (uint32_t i = 0; i < 3; ++i) {
+		float r = levels[i].max_screen_radius;
+		float error = r * (1.0f - std::cos(3.14159265f / segments_of_level[i]));
+		REQUIRE(error == Approx(0.5f).epsilon(1e-4));
+		REQUIRE(chain.select(r) == i);
+		REQUIRE(chain.select(r * 1.01f) == i + 1);
+	}
+}
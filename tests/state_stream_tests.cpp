@@ -0,0 +1,231 @@
+
+#include <catch.hpp>
+
+#include "state_stream.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace game::state_stream;
+
+namespace {
+	const std::vector<track_info> test_tracks = {
+		{ "position", { 0.01f, 0.01f, 0.001f } },
+		{ "health", { 1.0f } }
+	};
+
+	// random walk of entities appearing, disappearing, gaining and losing tracks and moving around.
+	std::vector<frame_state> random_states(uint32_t seed, uint64_t ticks) {
+		std::mt19937 rng(seed);
+		std::vector<frame_state> states;
+		frame_state previous;
+		previous.tracks.assign(test_tracks.size(), {});
+		for (uint64_t tick = 0; tick < ticks; ++tick) {
+			frame_state state;
+			state.tick = tick;
+			state.time = tick / 60.0f;
+			for (uint64_t id : previous.ids)
+				if (rng() % 30 != 0)
+					state.ids.push_back(id);
+			for (uint32_t k = rng() % 4; k > 0; --k)
+				state.ids.push_back(rng() % 500);
+			std::sort(state.ids.begin(), state.ids.end());
+			state.ids.erase(std::unique(state.ids.begin(), state.ids.end()), state.ids.end());
+
+			state.tracks.assign(test_tracks.size(), {});
+			for (size_t t = 0; t < test_tracks.size(); ++t) {
+				size_t channels = test_tracks[t].quanta.size();
+				auto& track = state.tracks[t];
+				track.present.assign(state.ids.size(), 0);
+				track.values.assign(state.ids.size() * channels, 0);
+				for (size_t i = 0; i < state.ids.size(); ++i) {
+					size_t j = previous.find(state.ids[i]);
+					bool existed = j < previous.ids.size() && previous.tracks[t].present[j];
+					track.present[i] = existed ? (rng() % 50 != 0) : (rng() % 3 != 0);
+					for (size_t c = 0; c < channels; ++c) {
+						int32_t old_value = existed ? previous.tracks[t].values[j * channels + c] : int32_t(rng() % 100000) - 50000;
+						track.values[i * channels + c] = rng() % 4 == 0 ? old_value : old_value + int32_t(rng() % 2001) - 1000;
+					}
+				}
+			}
+			previous = state;
+			states.emplace_back(std::move(state));
+		}
+		return states;
+	}
+
+	// encoded the way the writer encodes what it captures.
+	std::vector<uint8_t> encode_stream(const std::vector<frame_state>& states, uint64_t keyframe_interval) {
+		byte_writer out;
+		encode_header(out, test_tracks);
+		frame_state previous;
+		previous.tracks.assign(test_tracks.size(), {});
+		for (const auto& state : states) {
+			byte_writer payload;
+			bool is_keyframe = state.tick % keyframe_interval == 0;
+			if (is_keyframe)
+				encode_keyframe(payload, test_tracks, state);
+			else
+				encode_delta(payload, test_tracks, previous, state);
+			encode_frame(out, is_keyframe ? keyframe : delta, state.tick, state.time, payload);
+			previous = state;
+		}
+		return out.bytes;
+	}
+
+	std::string write_temp_file(const std::string& name, const uint8_t* data, size_t size) {
+		std::string path = (std::filesystem::temp_directory_path() / name).string();
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(data), std::streamsize(size));
+		return path;
+	}
+
+	// presence everywhere, values only where present, the reader keeps whatever it had elsewhere.
+	bool same_state(const frame_state& a, const frame_state& b) {
+		if (a.tick != b.tick || a.ids != b.ids || a.tracks.size() != b.tracks.size())
+			return false;
+		for (size_t t = 0; t < a.tracks.size(); ++t) {
+			size_t channels = test_tracks[t].quanta.size();
+			if (a.tracks[t].present != b.tracks[t].present)
+				return false;
+			for (size_t i = 0; i < a.ids.size(); ++i)
+				if (a.tracks[t].present[i] && !std::equal(&a.tracks[t].values[i * channels], &a.tracks[t].values[(i + 1) * channels], &b.tracks[t].values[i * channels]))
+					return false;
+		}
+		return true;
+	}
+}
+
+TEST_CASE("state stream round trip", "[state_stream]") {
+	auto states = random_states(7, 400);
+	auto bytes = encode_stream(states, 60);
+	auto path = write_temp_file("state_stream_round_trip.rstm", bytes.data(), bytes.size());
+
+	reader in;
+	REQUIRE(in.open(path));
+	REQUIRE(in.tracks().size() == test_tracks.size());
+	REQUIRE(in.tracks()[0].name == "position");
+	REQUIRE(in.tracks()[0].quanta == test_tracks[0].quanta);
+	REQUIRE(in.frame_count() == states.size());
+	REQUIRE(in.keyframe_count() == 7);
+	REQUIRE(in.first_tick() == 0);
+	REQUIRE(in.last_tick() == 399);
+
+	SECTION("playing forward") {
+		for (const auto& state : states) {
+			REQUIRE(in.seek(state.tick));
+			REQUIRE(same_state(in.state(), state));
+		}
+	}
+
+	SECTION("seeking around") {
+		std::mt19937 rng(11);
+		for (int i = 0; i < 300; ++i) {
+			const auto& state = states[rng() % states.size()];
+			REQUIRE(in.seek(state.tick));
+			REQUIRE(same_state(in.state(), state));
+		}
+	}
+
+	SECTION("dequantized values") {
+		REQUIRE(in.seek(123));
+		const auto& state = states[123];
+		for (size_t i = 0; i < state.ids.size(); ++i) {
+			REQUIRE(in.has(1, i) == bool(state.tracks[1].present[i]));
+			if (state.tracks[0].present[i])
+				REQUIRE(in.value(0, i, 2) == Approx(state.tracks[0].values[i * 3 + 2] * 0.001f));
+		}
+	}
+
+	std::remove(path.c_str());
+}
+
+TEST_CASE("state stream with a truncated last frame", "[state_stream]") {
+	auto states = random_states(8, 100);
+	auto bytes = encode_stream(states, 30);
+
+	// cut into the middle of the last frame, like a recording that is still being written.
+	auto path = write_temp_file("state_stream_truncated.rstm", bytes.data(), bytes.size() - 3);
+	reader in;
+	REQUIRE(in.open(path));
+	REQUIRE(in.frame_count() == states.size() - 1);
+	REQUIRE(in.last_tick() == 98);
+
+	REQUIRE(in.seek(98));
+	REQUIRE(same_state(in.state(), states[98]));
+
+	// asking for the lost tick gives the last one that made it.
+	REQUIRE(in.seek(99));
+	REQUIRE(same_state(in.state(), states[98]));
+
+	REQUIRE(in.seek(10));
+	REQUIRE(same_state(in.state(), states[10]));
+
+	std::remove(path.c_str());
+}
+
+TEST_CASE("state stream rejects broken headers", "[state_stream]") {
+	auto bytes = encode_stream(random_states(9, 10), 5);
+	reader in;
+
+	auto path = write_temp_file("state_stream_header.rstm", bytes.data(), 3);
+	REQUIRE_FALSE(in.open(path));
+
+	bytes[0] = 'X';
+	path = write_temp_file("state_stream_header.rstm", bytes.data(), bytes.size());
+	REQUIRE_FALSE(in.open(path));
+
+	REQUIRE_FALSE(in.open((std::filesystem::temp_directory_path() / "state_stream_missing.rstm").string()));
+	std::remove(path.c_str());
+}
+
+TEST_CASE("state stream rejects oversized id runs", "[state_stream]") {
+	std::vector<uint64_t> ids;
+
+	// one run of 2^62 ids in a handful of bytes.
+	byte_writer huge;
+	huge.varint(1);
+	huge.varint(0);
+	huge.varint(uint64_t(1) << 62);
+	byte_reader huge_in(huge.bytes.data(), huge.bytes.size());
+	REQUIRE_FALSE(read_id_runs(huge_in, ids));
+	REQUIRE(ids.empty());
+
+	// a gap that wraps around the id space.
+	byte_writer wrapping;
+	wrapping.varint(2);
+	wrapping.varint(10);
+	wrapping.varint(5);
+	wrapping.varint(~uint64_t(0));
+	wrapping.varint(1);
+	byte_reader wrapping_in(wrapping.bytes.data(), wrapping.bytes.size());
+	REQUIRE_FALSE(read_id_runs(wrapping_in, ids));
+
+	// run count promising more than the bytes hold.
+	byte_writer truncated;
+	truncated.varint(1000000);
+	truncated.varint(0);
+	byte_reader truncated_in(truncated.bytes.data(), truncated.bytes.size());
+	REQUIRE_FALSE(read_id_runs(truncated_in, ids));
+
+	// a keyframe listing more entities than it has presence bits for.
+	byte_writer keyframe;
+	keyframe.varint(1);
+	keyframe.varint(0);
+	keyframe.varint(max_entities);
+	keyframe.u8(0xff);
+	byte_reader keyframe_in(keyframe.bytes.data(), keyframe.bytes.size());
+	frame_state state;
+	REQUIRE_FALSE(decode_keyframe(keyframe_in, test_tracks, state));
+
+	byte_writer valid;
+	write_id_runs(valid, { 1, 2, 3, 10, 11 });
+	byte_reader valid_in(valid.bytes.data(), valid.bytes.size());
+	REQUIRE(read_id_runs(valid_in, ids));
+	REQUIRE(ids == std::vector<uint64_t>{ 1, 2, 3, 10, 11 });
+}
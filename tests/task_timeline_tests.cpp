@@ -0,0 +1,49 @@
+#include <catch.hpp>
+
+#include "task_timeline.hpp"
+
+#include <chrono>
+#include <thread>
+
+namespace {
+	void work_for(std::chrono::milliseconds duration) {
+		std::this_thread::sleep_for(duration);
+	}
+}
+
+TEST_CASE("task timeline keeps spans on the critical path but out of thread time", "[task_timeline]") {
+	game::task_timeline timeline;
+	auto task = timeline.declare("game task");
+	auto span = timeline.declare_span("engine ruleset");
+	timeline.depends_on(span, task);
+
+	timeline.begin_frame();
+	{
+		auto timing = timeline.record(task);
+		work_for(std::chrono::milliseconds(2));
+	}
+	timeline.span_begin(span);
+	work_for(std::chrono::milliseconds(5));
+	timeline.span_end(span);
+	timeline.end_frame();
+
+	auto summary = timeline.summary();
+	REQUIRE(summary.tasks.size() == 2);
+	REQUIRE(!summary.tasks[0].span);
+	REQUIRE(summary.tasks[1].span);
+	REQUIRE(summary.tasks[1].avg_duration_ms >= 5.0);
+
+	REQUIRE(summary.last_critical_path.size() == 2);
+	REQUIRE(summary.last_critical_path.back() == "engine ruleset");
+
+	// only the game task counts as work, the span's time isn't known to belong to any thread.
+	double busy = 0;
+	for (const auto& t : summary.threads)
+		busy += t.busy_ms;
+	REQUIRE(busy < summary.tasks[1].avg_duration_ms);
+	REQUIRE(summary.parallelism < 0.5f);
+
+	auto report = timeline.report_text();
+	REQUIRE(report.find("[span]") != std::string::npos);
+	REQUIRE(report.find("counts as idle") != std::string::npos);
+}